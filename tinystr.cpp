@@ -56,8 +56,9 @@ TiXmlString& TiXmlString::assign(const char* str, size_type len)
 		memcpy(tmp.start(), str, len);
 		swap(tmp);
 	}
-	else
+	else if (rep_ != &nullrep_)
 	{
+		// (The shared null rep is never written to: other threads use it too.)
 		memmove(start(), str, len);
 		set_size(len);
 	}
@@ -72,8 +73,11 @@ TiXmlString& TiXmlString::append(const char* str, size_type len)
 	{
 		reserve (newsize + capacity());
 	}
-	memmove(finish(), str, len);
-	set_size(newsize);
+	if (rep_ != &nullrep_)
+	{
+		memmove(finish(), str, len);
+		set_size(newsize);
+	}
 	return *this;
 }
 
@@ -187,6 +187,21 @@ class TiXmlString
 		init(0,0);
 	}
 
+	/*	Change the length of the string. A longer string is padded with nulls. Unlike clear()
+		or assigning "", shortening the string never gives up the buffer.
+	*/
+	void resize (size_type sz)
+	{
+		if (sz > length())
+		{
+			size_type oldSize = length();
+			reserve(sz);
+			memset(start() + oldSize, 0, sz - oldSize);
+		}
+		if (rep_ != &nullrep_)
+			set_size(sz);
+	}
+
 	/*	Function to reserve a big amount of data when we know we'll need it. Be aware that this
 		function DOES NOT clear the content of the TiXmlString if any exists.
 	*/
@@ -23,6 +23,30 @@ distribution.
 */
 
 #include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+
+#if defined( _WIN32 )
+	#ifndef WIN32_LEAN_AND_MEAN
+	#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+	#include <io.h>
+	#include <sys/stat.h>
+#else
+	#include <sys/types.h>
+	#include <sys/stat.h>
+	#include <sys/mman.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#if !defined( MAP_ANONYMOUS ) && defined( MAP_ANON )
+		#define MAP_ANONYMOUS MAP_ANON
+	#endif
+#endif
+
+#ifdef TIXML_USE_ZLIB
+#include <zlib.h>
+#endif
 
 #ifdef TIXML_USE_STL
 #include <sstream>
@@ -49,18 +73,135 @@ FILE* TiXmlFOpen( const char* filename, const char* mode )
 	#endif
 }
 
+void TiXmlBase::CopyLocation( TiXmlBase* target ) const
+{
+	#ifndef TIXML_SLIM_NODES
+	target->userData = userData;
+	target->location = location;
+	#else
+	(void) target;
+	#endif
+}
+
+
+void TiXmlBase::ClearLocation()
+{
+	#ifndef TIXML_SLIM_NODES
+	location.Clear();
+	#endif
+}
+
+
+void TiXmlBase::ClearLocationAndUserData()
+{
+	#ifndef TIXML_SLIM_NODES
+	userData = 0;
+	location.Clear();
+	#endif
+}
+
+
+// Print( FILE* ) writes with these rather than fprintf(), so that there are
+// no format strings to parse.
+static void TiXmlPut( FILE* cfile, const TIXML_STRING& str )
+{
+	fwrite( str.c_str(), 1, str.length(), cfile );
+}
+
+
+static void TiXmlPutEncoded( FILE* cfile, const TIXML_STRING& str )
+{
+	if ( !TiXmlBase::NeedsEncoding( str ) )
+	{
+		TiXmlPut( cfile, str );
+		return;
+	}
+	TIXML_STRING buffer;
+	TiXmlBase::EncodeString( str, &buffer );
+	TiXmlPut( cfile, buffer );
+}
+
+
+static void TiXmlPutIndent( FILE* cfile, int depth )
+{
+	for( int i=0; i<depth; ++i )
+		fputs( "    ", cfile );
+}
+
+
+// What EncodeString() does with each byte: 0 to copy it as it is, 1 to 5 to
+// write entity[0] to entity[4], or 6 to write a character reference.
+static const unsigned char encodeTable[ 256 ] =
+{
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+	0, 0, 4, 0, 0, 0, 1, 5, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 3, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+
 void TiXmlBase::EncodeString( const TIXML_STRING& str, TIXML_STRING* outString )
 {
+	EncodeString( str.c_str(), str.length(), outString );
+}
+
+
+void TiXmlBase::EncodeString( const char* str, size_t length, TIXML_STRING* outString )
+{
+	outString->reserve( outString->length() + length );
+	Encode( str, length, outString );
+}
+
+
+bool TiXmlBase::NeedsEncoding( const TIXML_STRING& str )
+{
+	// Errs on the safe side for "&#x", which Encode() lets through.
+	const unsigned char* p = (const unsigned char*) str.c_str();
+	const unsigned char* end = p + str.length();
+	while ( p < end && !encodeTable[ *p ] )
+		++p;
+	return p < end;
+}
+
+
+void TiXmlBase::Encode( const char* p, size_t _length, TIXML_STRING* outString )
+{
+	const int length = (int)_length;
 	int i=0;
 
-	while( i<(int)str.length() )
+	while( i<length )
 	{
-		unsigned char c = (unsigned char) str[i];
+		// Copy the run of characters that need no encoding in one go.
+		int run = i;
+		while ( run < length && !encodeTable[ (unsigned char) p[run] ] )
+			++run;
+		if ( run > i )
+		{
+			outString->append( p + i, run - i );
+			i = run;
+			if ( i == length )
+				break;
+		}
+
+		unsigned char c = (unsigned char) p[i];
+		int code = encodeTable[c];
 
 		if (    c == '&' 
-		     && i < ( (int)str.length() - 2 )
-			 && str[i+1] == '#'
-			 && str[i+2] == 'x' )
+		     && i < ( length - 2 )
+			 && p[i+1] == '#'
+			 && p[i+2] == 'x' )
 		{
 			// Hexadecimal character reference.
 			// Pass through unchanged.
@@ -72,67 +213,44 @@ void TiXmlBase::EncodeString( const TIXML_STRING& str, TIXML_STRING* outString )
 			// while fails (error case) and break (semicolon found).
 			// However, there is no mechanism (currently) for
 			// this function to return an error.
-			while ( i<(int)str.length()-1 )
+			int start = i;
+			while ( i<length-1 )
 			{
-				outString->append( str.c_str() + i, 1 );
 				++i;
-				if ( str[i] == ';' )
+				if ( p[i] == ';' )
 					break;
 			}
+			outString->append( p + start, i - start );
 		}
-		else if ( c == '&' )
-		{
-			outString->append( entity[0].str, entity[0].strLength );
-			++i;
-		}
-		else if ( c == '<' )
-		{
-			outString->append( entity[1].str, entity[1].strLength );
-			++i;
-		}
-		else if ( c == '>' )
+		else if ( code <= NUM_ENTITY )
 		{
-			outString->append( entity[2].str, entity[2].strLength );
-			++i;
-		}
-		else if ( c == '\"' )
-		{
-			outString->append( entity[3].str, entity[3].strLength );
-			++i;
-		}
-		else if ( c == '\'' )
-		{
-			outString->append( entity[4].str, entity[4].strLength );
-			++i;
-		}
-		else if ( c < 32 )
-		{
-			// Easy pass at non-alpha/numeric/symbol
-			// Below 32 is symbolic.
-			char buf[ 32 ];
-			
-			#if defined(TIXML_SNPRINTF)		
-				TIXML_SNPRINTF( buf, sizeof(buf), "&#x%02X;", (unsigned) ( c & 0xff ) );
-			#else
-				sprintf( buf, "&#x%02X;", (unsigned) ( c & 0xff ) );
-			#endif		
-
-			//*ME:	warning C4267: convert 'size_t' to 'int'
-			//*ME:	Int-Cast to make compiler happy ...
-			outString->append( buf, (int)strlen( buf ) );
+			outString->append( entity[code-1].str, entity[code-1].strLength );
 			++i;
 		}
 		else
 		{
-			//char realc = (char) c;
-			//outString->append( &realc, 1 );
-			*outString += (char) c;	// somewhat more efficient function call.
+			// Below 32 is symbolic.
+			static const char hex[] = "0123456789ABCDEF";
+			char buf[ 6 ] = { '&', '#', 'x', hex[ c >> 4 ], hex[ c & 15 ], ';' };
+			outString->append( buf, 6 );
 			++i;
 		}
 	}
 }
 
 
+// What a caching TiXmlPrinter keeps of an element's output. It is only good
+// for printing at the same depth with the same indent and line break.
+class TiXmlPrintCache
+{
+public:
+	int depth;
+	TIXML_STRING indent;
+	TIXML_STRING lineBreak;
+	TIXML_STRING output;
+};
+
+
 TiXmlNode::TiXmlNode( NodeType _type ) : TiXmlBase()
 {
 	parent = 0;
@@ -141,45 +259,77 @@ TiXmlNode::TiXmlNode( NodeType _type ) : TiXmlBase()
 	lastChild = 0;
 	prev = 0;
 	next = 0;
+	recyclable = false;
 }
 
 
 TiXmlNode::~TiXmlNode()
 {
-	TiXmlNode* node = firstChild;
-	TiXmlNode* temp = 0;
+	Clear();
+}
 
-	while ( node )
+
+void TiXmlNode::ValueChanged()
+{
+	TiXmlText* text = AsText();
+	if ( text )
+		text->plain = !NeedsEncoding( value );
+	Changed();
+}
+
+
+void TiXmlNode::Changed()
+{
+	#ifndef TIXML_SLIM_NODES
+	// Only elements keep output, so a leaf starts with its parent. A stale
+	// element is only in stale elements, so the walk can stop there.
+	TiXmlElement* element = AsElement() ? AsElement() : ( parent ? parent->AsElement() : 0 );
+	while ( element && !element->stale )
 	{
-		temp = node;
-		node = node->next;
-		delete temp;
-	}	
+		element->stale = true;
+		delete element->printCache;
+		element->printCache = 0;
+		element = element->parent ? element->parent->AsElement() : 0;
+	}
+	#endif
 }
 
 
 void TiXmlNode::CopyTo( TiXmlNode* target ) const
 {
 	target->SetValue (value.c_str() );
-	target->userData = userData; 
-	target->location = location;
+	CopyLocation( target );
 }
 
 
 void TiXmlNode::Clear()
 {
+	// Deleting a child used to delete its children in turn, recursing as deep
+	// as the tree. Instead, the children of each node are spliced in to the
+	// list ahead of its next sibling before it is deleted, so every delete
+	// is of a node that no longer has children.
 	TiXmlNode* node = firstChild;
 	TiXmlNode* temp = 0;
 
+	if ( firstChild )
+		Changed();
+	firstChild = 0;
+	lastChild = 0;
+
 	while ( node )
 	{
+		if ( node->firstChild )
+		{
+			node->lastChild->next = node->next;
+			node->next = node->firstChild;
+			node->firstChild = 0;
+			node->lastChild = 0;
+		}
 		temp = node;
 		node = node->next;
+		temp->parent = 0;	// which may already be deleted
 		delete temp;
 	}	
-
-	firstChild = 0;
-	lastChild = 0;
 }
 
 
@@ -207,6 +357,8 @@ TiXmlNode* TiXmlNode::LinkEndChild( TiXmlNode* node )
 		firstChild = node;			// it was an empty list.
 
 	lastChild = node;
+	LinkElement( node );
+	Changed();
 	return node;
 }
 
@@ -256,6 +408,8 @@ TiXmlNode* TiXmlNode::InsertBeforeChild( TiXmlNode* beforeThis, const TiXmlNode&
 		firstChild = node;
 	}
 	beforeThis->prev = node;
+	LinkElement( node );
+	Changed();
 	return node;
 }
 
@@ -289,6 +443,8 @@ TiXmlNode* TiXmlNode::InsertAfterChild( TiXmlNode* afterThis, const TiXmlNode& a
 		lastChild = node;
 	}
 	afterThis->next = node;
+	LinkElement( node );
+	Changed();
 	return node;
 }
 
@@ -301,7 +457,7 @@ TiXmlNode* TiXmlNode::ReplaceChild( TiXmlNode* replaceThis, const TiXmlNode& wit
 	if ( replaceThis->parent != this )
 		return 0;
 
-	if ( withThis.ToDocument() ) {
+	if ( withThis.AsDocument() ) {
 		// A document can never be a child.	Thanks to Noam.
 		TiXmlDocument* document = GetDocument();
 		if ( document ) 
@@ -313,6 +469,7 @@ TiXmlNode* TiXmlNode::ReplaceChild( TiXmlNode* replaceThis, const TiXmlNode& wit
 	if ( !node )
 		return 0;
 
+	UnlinkElement( replaceThis );
 	node->next = replaceThis->next;
 	node->prev = replaceThis->prev;
 
@@ -328,6 +485,8 @@ TiXmlNode* TiXmlNode::ReplaceChild( TiXmlNode* replaceThis, const TiXmlNode& wit
 
 	delete replaceThis;
 	node->parent = this;
+	LinkElement( node );
+	Changed();
 	return node;
 }
 
@@ -344,6 +503,7 @@ bool TiXmlNode::RemoveChild( TiXmlNode* removeThis )
 		return false;
 	}
 
+	UnlinkElement( removeThis );
 	if ( removeThis->next )
 		removeThis->next->prev = removeThis->prev;
 	else
@@ -354,10 +514,86 @@ bool TiXmlNode::RemoveChild( TiXmlNode* removeThis )
 	else
 		firstChild = removeThis->next;
 
+	removeThis->parent = 0;
 	delete removeThis;
+	Changed();
 	return true;
 }
 
+TiXmlNode* TiXmlNode::DetachChild( TiXmlNode* detachThis )
+{
+	if ( !detachThis || detachThis->parent != this )
+		return 0;
+
+	UnlinkElement( detachThis );
+	if ( detachThis->next )
+		detachThis->next->prev = detachThis->prev;
+	else
+		lastChild = detachThis->prev;
+
+	if ( detachThis->prev )
+		detachThis->prev->next = detachThis->next;
+	else
+		firstChild = detachThis->next;
+
+	detachThis->parent = 0;
+	detachThis->prev = 0;
+	detachThis->next = 0;
+	Changed();
+	return detachThis;
+}
+
+
+void TiXmlNode::LinkElement( TiXmlNode* node )
+{
+	#ifndef TIXML_SLIM_NODES
+	TiXmlElement* element = node->AsElement();
+	if ( !element )
+		return;
+
+	// Find the nearest element before; the one after is then its old next
+	// element. Only if there isn't one before does the list need walking on.
+	TiXmlElement* before = 0;
+	TiXmlElement* after = 0;
+	TiXmlNode* sibling;
+	for( sibling = node->prev; sibling && !before; sibling = sibling->prev )
+		before = sibling->AsElement();
+	if ( before )
+		after = before->nextElement;
+	else
+		for( sibling = node->next; sibling && !after; sibling = sibling->next )
+			after = sibling->AsElement();
+
+	element->prevElement = before;
+	element->nextElement = after;
+	if ( before )
+		before->nextElement = element;
+	if ( after )
+		after->prevElement = element;
+	#else
+	(void) node;
+	#endif
+}
+
+
+void TiXmlNode::UnlinkElement( TiXmlNode* node )
+{
+	#ifndef TIXML_SLIM_NODES
+	TiXmlElement* element = node->AsElement();
+	if ( !element )
+		return;
+
+	if ( element->prevElement )
+		element->prevElement->nextElement = element->nextElement;
+	if ( element->nextElement )
+		element->nextElement->prevElement = element->prevElement;
+	element->prevElement = 0;
+	element->nextElement = 0;
+	#else
+	(void) node;
+	#endif
+}
+
 const TiXmlNode* TiXmlNode::FirstChild( const char * _value ) const
 {
 	const TiXmlNode* node;
@@ -446,6 +682,7 @@ void TiXmlElement::RemoveAttribute( const char * name )
 	{
 		attributeSet.Remove( node );
 		delete node;
+		Changed();
 	}
 }
 
@@ -457,8 +694,8 @@ const TiXmlElement* TiXmlNode::FirstChildElement() const
 			node;
 			node = node->NextSibling() )
 	{
-		if ( node->ToElement() )
-			return node->ToElement();
+		if ( node->AsElement() )
+			return node->AsElement();
 	}
 	return 0;
 }
@@ -466,14 +703,14 @@ const TiXmlElement* TiXmlNode::FirstChildElement() const
 
 const TiXmlElement* TiXmlNode::FirstChildElement( const char * _value ) const
 {
-	const TiXmlNode* node;
+	const TiXmlElement* element;
 
-	for (	node = FirstChild( _value );
-			node;
-			node = node->NextSibling( _value ) )
+	for (	element = FirstChildElement();
+			element;
+			element = element->NextSiblingElement() )
 	{
-		if ( node->ToElement() )
-			return node->ToElement();
+		if ( strcmp( element->Value(), _value ) == 0 )
+			return element;
 	}
 	return 0;
 }
@@ -481,14 +718,19 @@ const TiXmlElement* TiXmlNode::FirstChildElement( const char * _value ) const
 
 const TiXmlElement* TiXmlNode::NextSiblingElement() const
 {
+	#ifndef TIXML_SLIM_NODES
+	if ( type == TINYXML_ELEMENT )
+		return static_cast< const TiXmlElement* >( this )->nextElement;
+	#endif
+
 	const TiXmlNode* node;
 
 	for (	node = NextSibling();
 			node;
 			node = node->NextSibling() )
 	{
-		if ( node->ToElement() )
-			return node->ToElement();
+		if ( node->AsElement() )
+			return node->AsElement();
 	}
 	return 0;
 }
@@ -496,14 +738,49 @@ const TiXmlElement* TiXmlNode::NextSiblingElement() const
 
 const TiXmlElement* TiXmlNode::NextSiblingElement( const char * _value ) const
 {
+	const TiXmlElement* element;
+
+	for (	element = NextSiblingElement();
+			element;
+			element = element->NextSiblingElement() )
+	{
+		if ( strcmp( element->Value(), _value ) == 0 )
+			return element;
+	}
+	return 0;
+}
+
+
+const TiXmlElement* TiXmlNode::PreviousSiblingElement() const
+{
+	#ifndef TIXML_SLIM_NODES
+	if ( type == TINYXML_ELEMENT )
+		return static_cast< const TiXmlElement* >( this )->prevElement;
+	#endif
+
 	const TiXmlNode* node;
 
-	for (	node = NextSibling( _value );
+	for (	node = PreviousSibling();
 			node;
-			node = node->NextSibling( _value ) )
+			node = node->PreviousSibling() )
+	{
+		if ( node->AsElement() )
+			return node->AsElement();
+	}
+	return 0;
+}
+
+
+const TiXmlElement* TiXmlNode::PreviousSiblingElement( const char * _value ) const
+{
+	const TiXmlElement* element;
+
+	for (	element = PreviousSiblingElement();
+			element;
+			element = element->PreviousSiblingElement() )
 	{
-		if ( node->ToElement() )
-			return node->ToElement();
+		if ( strcmp( element->Value(), _value ) == 0 )
+			return element;
 	}
 	return 0;
 }
@@ -515,8 +792,8 @@ const TiXmlDocument* TiXmlNode::GetDocument() const
 
 	for( node = this; node; node = node->parent )
 	{
-		if ( node->ToDocument() )
-			return node->ToDocument();
+		if ( node->AsDocument() )
+			return node->AsDocument();
 	}
 	return 0;
 }
@@ -526,6 +803,11 @@ TiXmlElement::TiXmlElement (const char * _value)
 	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
 {
 	firstChild = lastChild = 0;
+	#ifndef TIXML_SLIM_NODES
+	prevElement = nextElement = 0;
+	stale = true;
+	printCache = 0;
+	#endif
 	value = _value;
 }
 
@@ -535,6 +817,11 @@ TiXmlElement::TiXmlElement( const std::string& _value )
 	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
 {
 	firstChild = lastChild = 0;
+	#ifndef TIXML_SLIM_NODES
+	prevElement = nextElement = 0;
+	stale = true;
+	printCache = 0;
+	#endif
 	value = _value;
 }
 #endif
@@ -544,6 +831,11 @@ TiXmlElement::TiXmlElement( const TiXmlElement& copy)
 	: TiXmlNode( TiXmlNode::TINYXML_ELEMENT )
 {
 	firstChild = lastChild = 0;
+	#ifndef TIXML_SLIM_NODES
+	prevElement = nextElement = 0;
+	stale = true;
+	printCache = 0;
+	#endif
 	copy.CopyTo( this );	
 }
 
@@ -559,12 +851,17 @@ TiXmlElement& TiXmlElement::operator=( const TiXmlElement& base )
 TiXmlElement::~TiXmlElement()
 {
 	ClearThis();
+	#ifndef TIXML_SLIM_NODES
+	delete printCache;
+	#endif
 }
 
 
 void TiXmlElement::ClearThis()
 {
 	Clear();
+	if ( attributeSet.First() )
+		Changed();
 	while( attributeSet.First() )
 	{
 		TiXmlAttribute* node = attributeSet.First();
@@ -702,6 +999,7 @@ void TiXmlElement::SetAttribute( const char * name, int val )
 {	
 	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
 	if ( attrib ) {
+		attrib->SetOwner( this );
 		attrib->SetIntValue( val );
 	}
 }
@@ -712,6 +1010,7 @@ void TiXmlElement::SetAttribute( const std::string& name, int val )
 {	
 	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
 	if ( attrib ) {
+		attrib->SetOwner( this );
 		attrib->SetIntValue( val );
 	}
 }
@@ -722,6 +1021,7 @@ void TiXmlElement::SetDoubleAttribute( const char * name, double val )
 {	
 	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
 	if ( attrib ) {
+		attrib->SetOwner( this );
 		attrib->SetDoubleValue( val );
 	}
 }
@@ -732,6 +1032,7 @@ void TiXmlElement::SetDoubleAttribute( const std::string& name, double val )
 {	
 	TiXmlAttribute* attrib = attributeSet.FindOrCreate( name );
 	if ( attrib ) {
+		attrib->SetOwner( this );
 		attrib->SetDoubleValue( val );
 	}
 }
@@ -742,6 +1043,7 @@ void TiXmlElement::SetAttribute( const char * cname, const char * cvalue )
 {
 	TiXmlAttribute* attrib = attributeSet.FindOrCreate( cname );
 	if ( attrib ) {
+		attrib->SetOwner( this );
 		attrib->SetValue( cvalue );
 	}
 }
@@ -752,6 +1054,7 @@ void TiXmlElement::SetAttribute( const std::string& _name, const std::string& _v
 {
 	TiXmlAttribute* attrib = attributeSet.FindOrCreate( _name );
 	if ( attrib ) {
+		attrib->SetOwner( this );
 		attrib->SetValue( _value );
 	}
 }
@@ -760,18 +1063,15 @@ void TiXmlElement::SetAttribute( const std::string& _name, const std::string& _v
 
 void TiXmlElement::Print( FILE* cfile, int depth ) const
 {
-	int i;
 	assert( cfile );
-	for ( i=0; i<depth; i++ ) {
-		fprintf( cfile, "    " );
-	}
-
-	fprintf( cfile, "<%s", value.c_str() );
+	TiXmlPutIndent( cfile, depth );
+	fputc( '<', cfile );
+	TiXmlPut( cfile, value );
 
 	const TiXmlAttribute* attrib;
 	for ( attrib = attributeSet.First(); attrib; attrib = attrib->Next() )
 	{
-		fprintf( cfile, " " );
+		fputc( ' ', cfile );
 		attrib->Print( cfile, depth );
 	}
 
@@ -782,31 +1082,33 @@ void TiXmlElement::Print( FILE* cfile, int depth ) const
 	TiXmlNode* node;
 	if ( !firstChild )
 	{
-		fprintf( cfile, " />" );
+		fputs( " />", cfile );
 	}
-	else if ( firstChild == lastChild && firstChild->ToText() )
+	else if ( firstChild == lastChild && firstChild->AsText() )
 	{
-		fprintf( cfile, ">" );
+		fputc( '>', cfile );
 		firstChild->Print( cfile, depth + 1 );
-		fprintf( cfile, "</%s>", value.c_str() );
+		fputs( "</", cfile );
+		TiXmlPut( cfile, value );
+		fputc( '>', cfile );
 	}
 	else
 	{
-		fprintf( cfile, ">" );
+		fputc( '>', cfile );
 
 		for ( node = firstChild; node; node=node->NextSibling() )
 		{
-			if ( !node->ToText() )
+			if ( !node->AsText() )
 			{
-				fprintf( cfile, "\n" );
+				fputc( '\n', cfile );
 			}
 			node->Print( cfile, depth+1 );
 		}
-		fprintf( cfile, "\n" );
-		for( i=0; i<depth; ++i ) {
-			fprintf( cfile, "    " );
-		}
-		fprintf( cfile, "</%s>", value.c_str() );
+		fputc( '\n', cfile );
+		TiXmlPutIndent( cfile, depth );
+		fputs( "</", cfile );
+		TiXmlPut( cfile, value );
+		fputc( '>', cfile );
 	}
 }
 
@@ -824,6 +1126,8 @@ void TiXmlElement::CopyTo( TiXmlElement* target ) const
 	attribute = attribute->Next() )
 	{
 		target->SetAttribute( attribute->Name(), attribute->Value() );
+		if ( attribute->Raw() )
+			target->attributeSet.Find( attribute->Name() )->SetRaw( true );
 	}
 
 	TiXmlNode* node = 0;
@@ -862,7 +1166,7 @@ const char* TiXmlElement::GetText() const
 {
 	const TiXmlNode* child = this->FirstChild();
 	if ( child ) {
-		const TiXmlText* childText = child->ToText();
+		const TiXmlText* childText = child->AsText();
 		if ( childText ) {
 			return childText->Value();
 		}
@@ -873,14 +1177,14 @@ const char* TiXmlElement::GetText() const
 
 TiXmlDocument::TiXmlDocument() : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
 {
-	tabsize = 4;
+	InitCache();
 	useMicrosoftBOM = false;
 	ClearError();
 }
 
 TiXmlDocument::TiXmlDocument( const char * documentName ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
 {
-	tabsize = 4;
+	InitCache();
 	useMicrosoftBOM = false;
 	value = documentName;
 	ClearError();
@@ -890,7 +1194,7 @@ TiXmlDocument::TiXmlDocument( const char * documentName ) : TiXmlNode( TiXmlNode
 #ifdef TIXML_USE_STL
 TiXmlDocument::TiXmlDocument( const std::string& documentName ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
 {
-	tabsize = 4;
+	InitCache();
 	useMicrosoftBOM = false;
     value = documentName;
 	ClearError();
@@ -900,6 +1204,7 @@ TiXmlDocument::TiXmlDocument( const std::string& documentName ) : TiXmlNode( TiX
 
 TiXmlDocument::TiXmlDocument( const TiXmlDocument& copy ) : TiXmlNode( TiXmlNode::TINYXML_DOCUMENT )
 {
+	InitCache();
 	copy.CopyTo( this );
 }
 
@@ -912,6 +1217,164 @@ TiXmlDocument& TiXmlDocument::operator=( const TiXmlDocument& copy )
 }
 
 
+TiXmlDocument::~TiXmlDocument()
+{
+	ReleaseCache();
+}
+
+
+void TiXmlDocument::InitCache()
+{
+	for( int i=0; i<TINYXML_TYPECOUNT; ++i )
+		freeNodes[i] = 0;
+	freeAttributes = 0;
+}
+
+
+void TiXmlDocument::Reset()
+{
+	ClearError();
+	useMicrosoftBOM = false;
+	ClearLocation();
+
+	TiXmlNode* node = firstChild;
+	firstChild = 0;
+	lastChild = 0;
+	while ( node )
+	{
+		TiXmlNode* next = node->next;
+		Recycle( node );
+		node = next;
+	}
+}
+
+
+void TiXmlDocument::ReleaseCache()
+{
+	for( int i=0; i<TINYXML_TYPECOUNT; ++i )
+	{
+		while ( freeNodes[i] )
+		{
+			TiXmlNode* node = freeNodes[i];
+			freeNodes[i] = node->next;
+			delete node;
+		}
+	}
+	while ( freeAttributes )
+	{
+		TiXmlAttribute* attribute = freeAttributes;
+		freeAttributes = attribute->next;
+		delete attribute;
+	}
+}
+
+
+TiXmlNode* TiXmlDocument::CachedNode( TiXmlNode::NodeType type )
+{
+	TiXmlNode* node = freeNodes[ type ];
+	if ( node )
+	{
+		freeNodes[ type ] = node->next;
+		node->next = 0;
+	}
+	return node;
+}
+
+
+TiXmlAttribute* TiXmlDocument::CachedAttribute()
+{
+	TiXmlAttribute* attribute = freeAttributes;
+	if ( attribute )
+	{
+		freeAttributes = attribute->next;
+		attribute->next = 0;
+	}
+	return attribute;
+}
+
+
+void TiXmlDocument::Recycle( TiXmlNode* node )
+{
+	assert( node );
+	node->next = 0;
+
+	// No recursion: the children of each node are spliced in to the list
+	// being worked through, ahead of whatever follows the node.
+	while ( node )
+	{
+		TiXmlNode* following = node->next;
+		if ( node->firstChild )
+		{
+			node->lastChild->next = following;
+			following = node->firstChild;
+			node->firstChild = 0;
+			node->lastChild = 0;
+		}
+
+		if ( node->type == TINYXML_DOCUMENT || !node->recyclable )
+		{
+			// Not one the parser made, so it may be of a derived class that
+			// mustn't be handed back as a plain node. (And a document can't
+			// be reused by the parser, and shouldn't be a child anyway.)
+			node->next = 0;
+			delete node;
+			node = following;
+			continue;
+		}
+
+		TiXmlElement* element = node->AsElement();
+		if ( element )
+		{
+			#ifndef TIXML_SLIM_NODES
+			element->prevElement = 0;
+			element->nextElement = 0;
+			element->stale = true;
+			delete element->printCache;
+			element->printCache = 0;
+			#endif
+			while( element->attributeSet.First() )
+			{
+				TiXmlAttribute* attribute = element->attributeSet.First();
+				element->attributeSet.Remove( attribute );
+				Recycle( attribute );
+			}
+		}
+		TiXmlText* text = node->AsText();
+		if ( text )
+		{
+			text->SetCDATA( false );
+			text->SetRaw( false );
+			text->plain = false;
+		}
+
+		node->value.resize( 0 );
+		node->parent = 0;
+		node->prev = 0;
+		node->ClearLocationAndUserData();
+
+		node->next = freeNodes[ node->type ];
+		freeNodes[ node->type ] = node;
+
+		node = following;
+	}
+}
+
+
+void TiXmlDocument::Recycle( TiXmlAttribute* attribute )
+{
+	assert( attribute );
+	attribute->name.resize( 0 );
+	attribute->value.resize( 0 );
+	attribute->raw = false;
+	attribute->plain = false;
+	attribute->ClearLocationAndUserData();
+	attribute->owner = 0;
+	attribute->prev = 0;
+	attribute->next = freeAttributes;
+	freeAttributes = attribute;
+}
+
+
 bool TiXmlDocument::LoadFile( TiXmlEncoding encoding )
 {
 	return LoadFile( Value(), encoding );
@@ -952,56 +1415,69 @@ bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
 		return false;
 	}
 
-	// Delete the existing data:
-	Clear();
-	location.Clear();
-
-	// Get the file size, so we can pre-allocate the string. HUGE speed impact.
-	long length = 0;
-	fseek( file, 0, SEEK_END );
-	length = ftell( file );
 	fseek( file, 0, SEEK_SET );
+	TiXmlFileInputSource source( file );
+	return LoadFile( &source, encoding );
+}
 
-	// Strange case, but good to handle up front.
-	if ( length <= 0 )
-	{
-		SetError( TIXML_ERROR_DOCUMENT_EMPTY, 0, 0, TIXML_ENCODING_UNKNOWN );
-		return false;
-	}
-
-	// Subtle bug here. TinyXml did use fgets. But from the XML spec:
-	// 2.11 End-of-Line Handling
-	// <snip>
-	// <quote>
-	// ...the XML processor MUST behave as if it normalized all line breaks in external 
-	// parsed entities (including the document entity) on input, before parsing, by translating 
-	// both the two-character sequence #xD #xA and any #xD that is not followed by #xA to 
-	// a single #xA character.
-	// </quote>
-	//
-	// It is not clear fgets does that, and certainly isn't clear it works cross platform. 
-	// Generally, you expect fgets to translate from the convention of the OS to the c/unix
-	// convention, and not work generally.
 
-	/*
-	while( fgets( buf, sizeof(buf), file ) )
-	{
-		data += buf;
+// Copies from 'p' to 'q', turning CR+LF and lone CRs in to LF, and returns
+// where the writing ended. 'q' can be 'p', to work in place, since it never
+// gets ahead. A CR at the very end is remembered in 'lastWasCR', so that an
+// LF at the start of the next block can be dropped.
+static char* TiXmlNormalizeNewLines( const char* p, const char* pEnd, char* q, bool* lastWasCR )
+{
+	const char CR = 0x0d;
+	const char LF = 0x0a;
+
+	if ( *lastWasCR && p < pEnd && *p == LF )
+		++p;
+	*lastWasCR = false;
+
+	while( p < pEnd ) {
+		if ( *p == CR ) {
+			*q++ = LF;
+			p++;
+			if ( p == pEnd ) {
+				*lastWasCR = true;
+			}
+			else if ( *p == LF ) {		// check for CR+LF (and skip LF)
+				p++;
+			}
+		}
+		else {
+			*q++ = *p++;
+		}
 	}
-	*/
+	return q;
+}
 
-	char* buf = new char[ length+1 ];
-	buf[0] = 0;
 
-	if ( fread( buf, length, 1, file ) != 1 ) {
-		delete [] buf;
+bool TiXmlDocument::LoadFile( TiXmlInputSource* source, TiXmlEncoding encoding )
+{
+	if ( !source ) 
+	{
 		SetError( TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
 		return false;
 	}
 
-	// Process the buffer in place to normalize new lines. (See comment above.)
-	// Copies from the 'p' to 'q' pointer, where p can advance faster if
-	// a newline-carriage return is hit.
+	// Delete the existing data:
+	Clear();
+	ClearLocation();
+
+	// Subtle bug here. TinyXml did use fgets. But from the XML spec:
+	// 2.11 End-of-Line Handling
+	// <snip>
+	// <quote>
+	// ...the XML processor MUST behave as if it normalized all line breaks in external 
+	// parsed entities (including the document entity) on input, before parsing, by translating 
+	// both the two-character sequence #xD #xA and any #xD that is not followed by #xA to 
+	// a single #xA character.
+	// </quote>
+	//
+	// It is not clear fgets does that, and certainly isn't clear it works cross platform. 
+	// Generally, you expect fgets to translate from the convention of the OS to the c/unix
+	// convention, and not work generally.
 	//
 	// Wikipedia:
 	// Systems based on ASCII or a compatible character set use either LF  (Line feed, '\n', 0x0A, 10 in decimal) or 
@@ -1009,31 +1485,91 @@ bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
 	//		* LF:    Multics, Unix and Unix-like systems (GNU/Linux, AIX, Xenix, Mac OS X, FreeBSD, etc.), BeOS, Amiga, RISC OS, and others
     //		* CR+LF: DEC RT-11 and most other early non-Unix, non-IBM OSes, CP/M, MP/M, DOS, OS/2, Microsoft Windows, Symbian OS
     //		* CR:    Commodore 8-bit machines, Apple II family, Mac OS up to version 9 and OS-9
+	//
+	// Each block is normalized as soon as it is read, so the data is only
+	// touched once.
 
-	const char* p = buf;	// the read head
-	char* q = buf;			// the write head
-	const char CR = 0x0d;
-	const char LF = 0x0a;
+	// Get the size, so we can pre-allocate the buffer. HUGE speed impact.
+	long size = source->Size();
 
-	buf[length] = 0;
-	while( *p ) {
-		assert( p < (buf+length) );
-		assert( q <= (buf+length) );
-		assert( q <= p );
+	// A source that has the input in memory already is parsed where it is,
+	// unless there are line endings to convert, which are converted straight
+	// in to the buffer.
+	const char* data = source->Data();
+	if ( data && size > 0 )
+	{
+		if ( !memchr( data, 0x0d, size ) )
+		{
+			Parse( data, 0, encoding );
+			return !Error();
+		}
+		char* buf = new char[ size + 1 ];
+		bool lastWasCR = false;
+		char* end = TiXmlNormalizeNewLines( data, data + size, buf, &lastWasCR );
+		*end = 0;
+		Parse( buf, 0, encoding );
+		delete [] buf;
+		return !Error();
+	}
 
-		if ( *p == CR ) {
-			*q++ = LF;
-			p++;
-			if ( *p == LF ) {		// check for CR+LF (and skip LF)
-				p++;
+	long capacity = ( size > 0 ) ? size + 1 : 64*1024;
+	long length = 0;		// normalized bytes in the buffer
+	bool lastWasCR = false;
+
+	char* buf = new char[ capacity ];
+	buf[0] = 0;
+
+	for( ;; )
+	{
+		int n = 0;
+		if ( capacity - length > 1 )
+		{
+			long room = capacity - length - 1;
+			n = source->Read( buf + length, room > INT_MAX ? INT_MAX : (int) room );
+		}
+		else
+		{
+			// The buffer is full. Check there is more to come before growing it,
+			// which is usually not the case when the size was known.
+			char probe[256];
+			n = source->Read( probe, sizeof( probe ) );
+			if ( n > 0 )
+			{
+				long newCapacity = capacity * 2;
+				if ( newCapacity < length + n + 1 )
+					newCapacity = length + n + 1;
+				char* newBuf = new char[ newCapacity ];
+				memcpy( newBuf, buf, length );
+				memcpy( newBuf + length, probe, n );
+				delete [] buf;
+				buf = newBuf;
+				capacity = newCapacity;
 			}
 		}
-		else {
-			*q++ = *p++;
+
+		if ( n < 0 )
+		{
+			delete [] buf;
+			SetError( TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
+			return false;
 		}
+		if ( n == 0 )
+			break;
+
+		// Process the block in place to normalize new lines. (See comment above.)
+		length = TiXmlNormalizeNewLines( buf + length, buf + length + n, buf + length, &lastWasCR ) - buf;
 	}
-	assert( q <= (buf+length) );
-	*q = 0;
+
+	// Strange case, but good to handle up front.
+	if ( length <= 0 )
+	{
+		delete [] buf;
+		SetError( TIXML_ERROR_DOCUMENT_EMPTY, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return false;
+	}
+
+	assert( length < capacity );
+	buf[length] = 0;
 
 	Parse( buf, 0, encoding );
 
@@ -1042,12 +1578,323 @@ bool TiXmlDocument::LoadFile( FILE* file, TiXmlEncoding encoding )
 }
 
 
+TiXmlFileInputSource::TiXmlFileInputSource( FILE* _file ) : file( _file ), size( -1 )
+{
+	if ( file )
+	{
+		long start = ftell( file );
+		if ( start >= 0 && fseek( file, 0, SEEK_END ) == 0 )
+		{
+			long end = ftell( file );
+			fseek( file, start, SEEK_SET );
+			if ( end >= start )
+				size = end - start;
+		}
+	}
+}
+
+
+int TiXmlFileInputSource::Read( char* buffer, int bufferSize )
+{
+	if ( !file )
+		return -1;
+	size_t count = fread( buffer, 1, bufferSize, file );
+	if ( count == 0 && ferror( file ) )
+		return -1;
+	return (int) count;
+}
+
+
+TiXmlFdInputSource::TiXmlFdInputSource( int _fd ) : fd( _fd ), size( -1 )
+{
+	#if defined( _WIN32 )
+		struct _stat st;
+		if ( fd >= 0 && _fstat( fd, &st ) == 0 && ( st.st_mode & _S_IFREG ) )
+		{
+			long start = _lseek( fd, 0, SEEK_CUR );
+			if ( start >= 0 && start <= (long) st.st_size )
+				size = (long) st.st_size - start;
+		}
+	#else
+		struct stat st;
+		if ( fd >= 0 && fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) )
+		{
+			off_t start = lseek( fd, 0, SEEK_CUR );
+			if ( start >= 0 && start <= st.st_size )
+				size = (long)( st.st_size - start );
+		}
+	#endif
+}
+
+
+int TiXmlFdInputSource::Read( char* buffer, int bufferSize )
+{
+	if ( fd < 0 )
+		return -1;
+	#if defined( _WIN32 )
+		return _read( fd, buffer, bufferSize );
+	#else
+		for( ;; )
+		{
+			ssize_t count = read( fd, buffer, bufferSize );
+			if ( count < 0 && errno == EINTR )
+				continue;
+			return (int) count;
+		}
+	#endif
+}
+
+
+int TiXmlMemoryInputSource::Read( char* buffer, int bufferSize )
+{
+	if ( !data && length > 0 )
+		return -1;
+	long left = length - pos;
+	int n = ( bufferSize > left ) ? (int) left : bufferSize;
+	if ( n > 0 )
+	{
+		memcpy( buffer, data + pos, n );
+		pos += n;
+	}
+	return n;
+}
+
+
+TiXmlMappedInputSource::TiXmlMappedInputSource( const char* filename ) : data( 0 ), length( 0 ), pos( 0 ), mapped( 0 ), opened( false ), terminated( false )
+{
+	if ( !filename )
+		return;
+
+	#if defined( _WIN32 )
+		HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0 );
+		if ( file == INVALID_HANDLE_VALUE )
+			return;
+		LARGE_INTEGER fileSize;
+		if ( GetFileSizeEx( file, &fileSize ) && fileSize.HighPart == 0 && fileSize.LowPart < 0x7fffffff )
+		{
+			opened = true;
+			length = (long) fileSize.LowPart;
+			if ( length > 0 )
+			{
+				// The view keeps the mapping (and the file) alive once it is created.
+				HANDLE mapping = CreateFileMappingA( file, 0, PAGE_READONLY, 0, 0, 0 );
+				if ( mapping )
+				{
+					data = (const char*) MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+					CloseHandle( mapping );
+				}
+				// The rest of the last page reads as zeros, if there is any.
+				SYSTEM_INFO info;
+				GetSystemInfo( &info );
+				terminated = ( length % info.dwPageSize ) != 0;
+				if ( !data )
+				{
+					opened = false;
+					length = 0;
+				}
+			}
+		}
+		CloseHandle( file );
+	#else
+		int fd = open( filename, O_RDONLY );
+		if ( fd < 0 )
+			return;
+		struct stat st;
+		if ( fstat( fd, &st ) == 0 && S_ISREG( st.st_mode ) && st.st_size < 0x7fffffff )
+		{
+			opened = true;
+			length = (long) st.st_size;
+			if ( length > 0 )
+			{
+				// Reserve at least one byte more than the file, zeroed, and
+				// map the file over the start of it: the parser wants a null
+				// at the end. (Past the end of the file, the last page of the
+				// file reads as zeros too.)
+				long pageSize = sysconf( _SC_PAGESIZE );
+				mapped = ( length / pageSize + 1 ) * pageSize;
+				void* mem = mmap( 0, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+				if ( mem != MAP_FAILED )
+				{
+					if ( mmap( mem, length, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0 ) == MAP_FAILED )
+					{
+						munmap( mem, mapped );
+						mem = MAP_FAILED;
+					}
+				}
+				if ( mem != MAP_FAILED )
+				{
+					data = (const char*) mem;
+					terminated = true;
+					#ifdef MADV_SEQUENTIAL
+					madvise( mem, length, MADV_SEQUENTIAL );
+					#endif
+				}
+				else
+				{
+					opened = false;
+					length = 0;
+					mapped = 0;
+				}
+			}
+		}
+		close( fd );
+	#endif
+}
+
+
+TiXmlMappedInputSource::~TiXmlMappedInputSource()
+{
+	if ( data )
+	{
+		#if defined( _WIN32 )
+			UnmapViewOfFile( data );
+		#else
+			munmap( (void*) data, mapped );
+		#endif
+	}
+}
+
+
+int TiXmlMappedInputSource::Read( char* buffer, int bufferSize )
+{
+	if ( !IsOpen() )
+		return -1;
+	long left = length - pos;
+	int n = ( bufferSize > left ) ? (int) left : bufferSize;
+	if ( n > 0 )
+	{
+		memcpy( buffer, data + pos, n );
+		pos += n;
+	}
+	return n;
+}
+
+
+#ifdef TIXML_USE_ZLIB
+TiXmlGzInputSource::TiXmlGzInputSource( const char* filename ) : gz( 0 ), size( -1 )
+{
+	if ( !filename )
+		return;
+
+	// The gzip trailer holds the uncompressed size (modulo 2^32) which makes
+	// a good hint for the buffer size. Only trust it for a real gzip file, and
+	// only if it's within what deflate can actually achieve.
+	FILE* fp = TiXmlFOpen( filename, "rb" );
+	if ( !fp )
+		return;
+	unsigned char magic[2];
+	unsigned char trailer[4];
+	if (    fread( magic, 2, 1, fp ) == 1
+		 && magic[0] == 0x1f && magic[1] == 0x8b
+		 && fseek( fp, -4, SEEK_END ) == 0 )
+	{
+		long compressed = ftell( fp ) + 4;
+		if ( fread( trailer, 4, 1, fp ) == 1 )
+		{
+			unsigned long isize =   (unsigned long) trailer[0]
+								| ( (unsigned long) trailer[1] << 8 )
+								| ( (unsigned long) trailer[2] << 16 )
+								| ( (unsigned long) trailer[3] << 24 );
+			if ( isize < 0x7fffffffUL && isize / 1032 <= (unsigned long) compressed )
+				size = (long) isize;
+		}
+	}
+	fclose( fp );
+
+	gzFile file = gzopen( filename, "rb" );
+	if ( file )
+	{
+		#if ZLIB_VERNUM >= 0x1235
+		gzbuffer( file, 128*1024 );
+		#endif
+		gz = file;
+	}
+}
+
+
+TiXmlGzInputSource::~TiXmlGzInputSource()
+{
+	if ( gz )
+		gzclose( (gzFile) gz );
+}
+
+
+int TiXmlGzInputSource::Read( char* buffer, int bufferSize )
+{
+	if ( !gz )
+		return -1;
+	return gzread( (gzFile) gz, buffer, (unsigned) bufferSize );
+}
+
+
+bool TiXmlDocument::LoadGzFile( const char* filename, TiXmlEncoding encoding )
+{
+	value = filename;
+
+	TiXmlGzInputSource source( filename );
+	if ( !source.IsOpen() )
+	{
+		SetError( TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
+		return false;
+	}
+	return LoadFile( &source, encoding );
+}
+
+
+// Compresses the output of a TiXmlPrinter in to a gzip file.
+class TiXmlGzOutputSink : public TiXmlOutputSink
+{
+public:
+	TiXmlGzOutputSink( gzFile _gz ) : gz( _gz ) {}
+	virtual bool Write( const char* data, int size )	{ return gzwrite( gz, data, size ) == size; }
+
+private:
+	gzFile gz;
+};
+
+
+bool TiXmlDocument::SaveGzFile( const char* filename, int level ) const
+{
+	char mode[4] = { 'w', 'b', 0, 0 };
+	if ( level >= 0 && level <= 9 )
+		mode[2] = (char)( '0' + level );
+
+	gzFile gz = gzopen( filename, mode );
+	if ( !gz )
+		return false;
+
+	bool ok = true;
+	if ( useMicrosoftBOM ) 
+	{
+		const char bom[3] = { (char) 0xef, (char) 0xbb, (char) 0xbf };
+		ok = gzwrite( gz, bom, 3 ) == 3;
+	}
+
+	if ( ok )
+	{
+		// Compress as the printer goes, rather than printing it all first.
+		TiXmlGzOutputSink sink( gz );
+		TiXmlPrinter printer;
+		printer.SetSink( &sink, 256 * 1024 );
+		Accept( &printer );
+		ok = printer.Flush();
+	}
+	if ( gzclose( gz ) != Z_OK )
+		ok = false;
+	return ok;
+}
+#endif
+
+
 bool TiXmlDocument::SaveFile( const char * filename ) const
 {
 	// The old c stuff lives on...
 	FILE* fp = TiXmlFOpen( filename, "w" );
 	if ( fp )
 	{
+		// Print() writes a piece at a time; a big buffer turns that in
+		// to a few large writes.
+		setvbuf( fp, 0, _IOFBF, 64 * 1024 );
 		bool result = SaveFile( fp );
 		fclose( fp );
 		return result;
@@ -1080,7 +1927,7 @@ void TiXmlDocument::CopyTo( TiXmlDocument* target ) const
 	target->error = error;
 	target->errorId = errorId;
 	target->errorDesc = errorDesc;
-	target->tabsize = tabsize;
+	target->parseOptions = parseOptions;
 	target->errorLocation = errorLocation;
 	target->useMicrosoftBOM = useMicrosoftBOM;
 
@@ -1109,7 +1956,7 @@ void TiXmlDocument::Print( FILE* cfile, int depth ) const
 	for ( const TiXmlNode* node=FirstChild(); node; node=node->NextSibling() )
 	{
 		node->Print( cfile, depth );
-		fprintf( cfile, "\n" );
+		fputc( '\n', cfile );
 	}
 }
 
@@ -1128,68 +1975,47 @@ bool TiXmlDocument::Accept( TiXmlVisitor* visitor ) const
 }
 
 
-const TiXmlAttribute* TiXmlAttribute::Next() const
+void TiXmlAttribute::Changed()
 {
-	// We are using knowledge of the sentinel. The sentinel
-	// have a value or name.
-	if ( next->value.empty() && next->name.empty() )
-		return 0;
-	return next;
+	if ( owner )
+		owner->Changed();
 }
 
-/*
-TiXmlAttribute* TiXmlAttribute::Next()
+
+const TiXmlAttribute* TiXmlAttribute::Next() const
 {
-	// We are using knowledge of the sentinel. The sentinel
-	// have a value or name.
-	if ( next->value.empty() && next->name.empty() )
-		return 0;
 	return next;
 }
-*/
+
 
 const TiXmlAttribute* TiXmlAttribute::Previous() const
 {
-	// We are using knowledge of the sentinel. The sentinel
-	// have a value or name.
-	if ( prev->value.empty() && prev->name.empty() )
-		return 0;
 	return prev;
 }
 
-/*
-TiXmlAttribute* TiXmlAttribute::Previous()
-{
-	// We are using knowledge of the sentinel. The sentinel
-	// have a value or name.
-	if ( prev->value.empty() && prev->name.empty() )
-		return 0;
-	return prev;
-}
-*/
 
 void TiXmlAttribute::Print( FILE* cfile, int /*depth*/, TIXML_STRING* str ) const
 {
-	TIXML_STRING n, v;
-
-	EncodeString( name, &n );
-	EncodeString( value, &v );
+	// A plain value has no '"' in it.
+	const char* quote = ( plain || value.find( '\"' ) == TIXML_STRING::npos ) ? "\"" : "'";
 
-	if (value.find ('\"') == TIXML_STRING::npos) {
-		if ( cfile ) {
-		fprintf (cfile, "%s=\"%s\"", n.c_str(), v.c_str() );
-		}
-		if ( str ) {
-			(*str) += n; (*str) += "=\""; (*str) += v; (*str) += "\"";
-		}
-	}
-	else {
-		if ( cfile ) {
-		fprintf (cfile, "%s='%s'", n.c_str(), v.c_str() );
-		}
-		if ( str ) {
-			(*str) += n; (*str) += "='"; (*str) += v; (*str) += "'";
-		}
+	if ( str ) {
+		EncodeString( name, str );
+		(*str) += "="; (*str) += quote;
+		if ( raw || plain )
+			(*str) += value;
+		else
+			EncodeString( value, str );
+		(*str) += quote;
+	}
+	if ( cfile ) {
+		TiXmlPutEncoded( cfile, name );
+		fputc( '=', cfile ); fputs( quote, cfile );
+		if ( raw || plain )
+			TiXmlPut( cfile, value );
+		else
+			TiXmlPutEncoded( cfile, value );
+		fputs( quote, cfile );
 	}
 }
 
@@ -1258,11 +2084,10 @@ TiXmlComment& TiXmlComment::operator=( const TiXmlComment& base )
 void TiXmlComment::Print( FILE* cfile, int depth ) const
 {
 	assert( cfile );
-	for ( int i=0; i<depth; i++ )
-	{
-		fprintf( cfile,  "    " );
-	}
-	fprintf( cfile, "<!--%s-->", value.c_str() );
+	TiXmlPutIndent( cfile, depth );
+	fputs( "<!--", cfile );
+	TiXmlPut( cfile, value );
+	fputs( "-->", cfile );
 }
 
 
@@ -1295,18 +2120,19 @@ void TiXmlText::Print( FILE* cfile, int depth ) const
 	assert( cfile );
 	if ( cdata )
 	{
-		int i;
-		fprintf( cfile, "\n" );
-		for ( i=0; i<depth; i++ ) {
-			fprintf( cfile, "    " );
-		}
-		fprintf( cfile, "<![CDATA[%s]]>\n", value.c_str() );	// unformatted output
+		fputc( '\n', cfile );
+		TiXmlPutIndent( cfile, depth );
+		fputs( "<![CDATA[", cfile );
+		TiXmlPut( cfile, value );	// unformatted output
+		fputs( "]]>\n", cfile );
+	}
+	else if ( raw || plain )
+	{
+		TiXmlPut( cfile, value );
 	}
 	else
 	{
-		TIXML_STRING buffer;
-		EncodeString( value, &buffer );
-		fprintf( cfile, "%s", buffer.c_str() );
+		TiXmlPutEncoded( cfile, value );
 	}
 }
 
@@ -1315,6 +2141,7 @@ void TiXmlText::CopyTo( TiXmlText* target ) const
 {
 	TiXmlNode::CopyTo( target );
 	target->cdata = cdata;
+	target->raw = raw;
 }
 
 
@@ -1378,22 +2205,22 @@ TiXmlDeclaration& TiXmlDeclaration::operator=( const TiXmlDeclaration& copy )
 
 void TiXmlDeclaration::Print( FILE* cfile, int /*depth*/, TIXML_STRING* str ) const
 {
-	if ( cfile ) fprintf( cfile, "<?xml " );
+	if ( cfile ) fputs( "<?xml ", cfile );
 	if ( str )	 (*str) += "<?xml ";
 
 	if ( !version.empty() ) {
-		if ( cfile ) fprintf (cfile, "version=\"%s\" ", version.c_str ());
+		if ( cfile ) { fputs( "version=\"", cfile ); TiXmlPut( cfile, version ); fputs( "\" ", cfile ); }
 		if ( str ) { (*str) += "version=\""; (*str) += version; (*str) += "\" "; }
 	}
 	if ( !encoding.empty() ) {
-		if ( cfile ) fprintf (cfile, "encoding=\"%s\" ", encoding.c_str ());
+		if ( cfile ) { fputs( "encoding=\"", cfile ); TiXmlPut( cfile, encoding ); fputs( "\" ", cfile ); }
 		if ( str ) { (*str) += "encoding=\""; (*str) += encoding; (*str) += "\" "; }
 	}
 	if ( !standalone.empty() ) {
-		if ( cfile ) fprintf (cfile, "standalone=\"%s\" ", standalone.c_str ());
+		if ( cfile ) { fputs( "standalone=\"", cfile ); TiXmlPut( cfile, standalone ); fputs( "\" ", cfile ); }
 		if ( str ) { (*str) += "standalone=\""; (*str) += standalone; (*str) += "\" "; }
 	}
-	if ( cfile ) fprintf( cfile, "?>" );
+	if ( cfile ) fputs( "?>", cfile );
 	if ( str )	 (*str) += "?>";
 }
 
@@ -1428,9 +2255,10 @@ TiXmlNode* TiXmlDeclaration::Clone() const
 
 void TiXmlUnknown::Print( FILE* cfile, int depth ) const
 {
-	for ( int i=0; i<depth; i++ )
-		fprintf( cfile, "    " );
-	fprintf( cfile, "<%s>", value.c_str() );
+	TiXmlPutIndent( cfile, depth );
+	fputc( '<', cfile );
+	TiXmlPut( cfile, value );
+	fputc( '>', cfile );
 }
 
 
@@ -1460,15 +2288,15 @@ TiXmlNode* TiXmlUnknown::Clone() const
 
 TiXmlAttributeSet::TiXmlAttributeSet()
 {
-	sentinel.next = &sentinel;
-	sentinel.prev = &sentinel;
+	first = 0;
+	last = 0;
 }
 
 
 TiXmlAttributeSet::~TiXmlAttributeSet()
 {
-	assert( sentinel.next == &sentinel );
-	assert( sentinel.prev == &sentinel );
+	assert( first == 0 );
+	assert( last == 0 );
 }
 
 
@@ -1480,36 +2308,44 @@ void TiXmlAttributeSet::Add( TiXmlAttribute* addMe )
 	assert( !Find( addMe->Name() ) );	// Shouldn't be multiply adding to the set.
 	#endif
 
-	addMe->next = &sentinel;
-	addMe->prev = sentinel.prev;
+	addMe->next = 0;
+	addMe->prev = last;
 
-	sentinel.prev->next = addMe;
-	sentinel.prev      = addMe;
+	if ( last )
+		last->next = addMe;
+	else
+		first = addMe;
+	last = addMe;
 }
 
 void TiXmlAttributeSet::Remove( TiXmlAttribute* removeMe )
 {
+	#ifdef DEBUG
 	TiXmlAttribute* node;
+	for( node = first; node && node != removeMe; node = node->next )
+	{}
+	assert( node );		// we tried to remove a non-linked attribute.
+	#endif
 
-	for( node = sentinel.next; node != &sentinel; node = node->next )
-	{
-		if ( node == removeMe )
-		{
-			node->prev->next = node->next;
-			node->next->prev = node->prev;
-			node->next = 0;
-			node->prev = 0;
-			return;
-		}
-	}
-	assert( 0 );		// we tried to remove a non-linked attribute.
+	if ( removeMe->prev )
+		removeMe->prev->next = removeMe->next;
+	else
+		first = removeMe->next;
+
+	if ( removeMe->next )
+		removeMe->next->prev = removeMe->prev;
+	else
+		last = removeMe->prev;
+
+	removeMe->next = 0;
+	removeMe->prev = 0;
 }
 
 
 #ifdef TIXML_USE_STL
 TiXmlAttribute* TiXmlAttributeSet::Find( const std::string& name ) const
 {
-	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+	for( TiXmlAttribute* node = first; node; node = node->next )
 	{
 		if ( node->name == name )
 			return node;
@@ -1532,7 +2368,7 @@ TiXmlAttribute* TiXmlAttributeSet::FindOrCreate( const std::string& _name )
 
 TiXmlAttribute* TiXmlAttributeSet::Find( const char* name ) const
 {
-	for( TiXmlAttribute* node = sentinel.next; node != &sentinel; node = node->next )
+	for( TiXmlAttribute* node = first; node; node = node->next )
 	{
 		if ( strcmp( node->name.c_str(), name ) == 0 )
 			return node;
@@ -1721,32 +2557,50 @@ bool TiXmlPrinter::VisitEnter( const TiXmlDocument& )
 
 bool TiXmlPrinter::VisitExit( const TiXmlDocument& )
 {
+	if ( output.sink )
+		Flush();
 	return true;
 }
 
 bool TiXmlPrinter::VisitEnter( const TiXmlElement& element, const TiXmlAttribute* firstAttribute )
 {
+	#ifndef TIXML_SLIM_NODES
+	if ( Caching() )
+	{
+		const TiXmlPrintCache* cache = element.printCache;
+		if (    cache && !element.stale
+			 && cache->depth == depth && cache->indent == indent && cache->lineBreak == lineBreak )
+		{
+			Write( cache->output );
+			fromCache = true;
+			return false;
+		}
+		size_t start = output.sent + output.buffer.length();
+		marks.append( (const char*) &start, sizeof( start ) );
+	}
+	#endif
+
 	DoIndent();
-	buffer += "<";
-	buffer += element.Value();
+	Write( "<", 1 );
+	Write( element.ValueTStr() );
 
 	for( const TiXmlAttribute* attrib = firstAttribute; attrib; attrib = attrib->Next() )
 	{
-		buffer += " ";
-		attrib->Print( 0, 0, &buffer );
+		Write( " ", 1 );
+		WriteAttribute( *attrib );
 	}
 
 	if ( !element.FirstChild() ) 
 	{
-		buffer += " />";
+		Write( " />", 3 );
 		DoLineBreak();
 	}
 	else 
 	{
-		buffer += ">";
-		if (    element.FirstChild()->ToText()
+		Write( ">", 1 );
+		if (    element.FirstChild()->AsText()
 			  && element.LastChild() == element.FirstChild()
-			  && element.FirstChild()->ToText()->CDATA() == false )
+			  && element.FirstChild()->AsText()->CDATA() == false )
 		{
 			simpleTextPrint = true;
 			// no DoLineBreak()!
@@ -1763,6 +2617,12 @@ bool TiXmlPrinter::VisitEnter( const TiXmlElement& element, const TiXmlAttribute
 
 bool TiXmlPrinter::VisitExit( const TiXmlElement& element )
 {
+	if ( fromCache )
+	{
+		fromCache = false;
+		return true;
+	}
+
 	--depth;
 	if ( !element.FirstChild() ) 
 	{
@@ -1778,11 +2638,39 @@ bool TiXmlPrinter::VisitExit( const TiXmlElement& element )
 		{
 			DoIndent();
 		}
-		buffer += "</";
-		buffer += element.Value();
-		buffer += ">";
+		Write( "</", 2 );
+		Write( element.ValueTStr() );
+		Write( ">", 1 );
 		DoLineBreak();
 	}
+
+	#ifndef TIXML_SLIM_NODES
+	if ( Caching() && marks.length() >= sizeof( size_t ) )
+	{
+		size_t start;
+		size_t top = marks.length() - sizeof( start );
+		memcpy( &start, marks.c_str() + top, sizeof( start ) );
+		marks.resize( top );
+
+		// If some of the output has gone to the sink, it can't be kept.
+		size_t length = output.sent + output.buffer.length() - start;
+		if ( start >= output.sent && length >= cacheSize )
+		{
+			if ( !element.printCache )
+				element.printCache = new TiXmlPrintCache();
+			element.printCache->depth = depth;
+			element.printCache->indent = indent;
+			element.printCache->lineBreak = lineBreak;
+			element.printCache->output.assign( output.buffer.c_str() + ( start - output.sent ), length );
+		}
+		else
+		{
+			delete element.printCache;
+			element.printCache = 0;
+		}
+		element.stale = false;
+	}
+	#endif
 	return true;
 }
 
@@ -1792,23 +2680,19 @@ bool TiXmlPrinter::Visit( const TiXmlText& text )
 	if ( text.CDATA() )
 	{
 		DoIndent();
-		buffer += "<![CDATA[";
-		buffer += text.Value();
-		buffer += "]]>";
+		Write( "<![CDATA[", 9 );
+		Write( text.ValueTStr() );
+		Write( "]]>", 3 );
 		DoLineBreak();
 	}
 	else if ( simpleTextPrint )
 	{
-		TIXML_STRING str;
-		TiXmlBase::EncodeString( text.ValueTStr(), &str );
-		buffer += str;
+		WriteText( text );
 	}
 	else
 	{
 		DoIndent();
-		TIXML_STRING str;
-		TiXmlBase::EncodeString( text.ValueTStr(), &str );
-		buffer += str;
+		WriteText( text );
 		DoLineBreak();
 	}
 	return true;
@@ -1818,7 +2702,8 @@ bool TiXmlPrinter::Visit( const TiXmlText& text )
 bool TiXmlPrinter::Visit( const TiXmlDeclaration& declaration )
 {
 	DoIndent();
-	declaration.Print( 0, 0, &buffer );
+	declaration.Print( 0, 0, &output.buffer );
+	output.Wrote();
 	DoLineBreak();
 	return true;
 }
@@ -1827,9 +2712,9 @@ bool TiXmlPrinter::Visit( const TiXmlDeclaration& declaration )
 bool TiXmlPrinter::Visit( const TiXmlComment& comment )
 {
 	DoIndent();
-	buffer += "<!--";
-	buffer += comment.Value();
-	buffer += "-->";
+	Write( "<!--", 4 );
+	Write( comment.ValueTStr() );
+	Write( "-->", 3 );
 	DoLineBreak();
 	return true;
 }
@@ -1838,10 +2723,742 @@ bool TiXmlPrinter::Visit( const TiXmlComment& comment )
 bool TiXmlPrinter::Visit( const TiXmlUnknown& unknown )
 {
 	DoIndent();
-	buffer += "<";
-	buffer += unknown.Value();
-	buffer += ">";
+	Write( "<", 1 );
+	Write( unknown.ValueTStr() );
+	Write( ">", 1 );
 	DoLineBreak();
 	return true;
 }
 
+
+void TiXmlPrinter::Reset()
+{
+	output.buffer.resize( 0 );
+	marks.resize( 0 );
+	fromCache = false;
+	depth = 0;
+	simpleTextPrint = false;
+}
+
+
+void TiXmlPrinter::Print( const TiXmlNode& node )
+{
+	node.Accept( this );
+	if ( output.sink )
+		Flush();
+}
+
+
+void TiXmlOutputBuffer::SetSink( TiXmlOutputSink* _sink, size_t _chunkSize )
+{
+	sink = _sink;
+	chunkSize = _chunkSize > 0 ? _chunkSize : 1;
+	sinkError = false;
+	if ( sink )
+		buffer.reserve( chunkSize );
+}
+
+
+bool TiXmlOutputBuffer::Flush()
+{
+	if ( sink && buffer.length() > 0 )
+	{
+		if ( !sink->Write( buffer.c_str(), (int) buffer.length() ) )
+			sinkError = true;
+		sent += buffer.length();
+		buffer.resize( 0 );
+	}
+	return !sinkError;
+}
+
+
+// Anything that goes on a line of its own first finishes the start tag, or
+// the line of text, before it.
+void TiXmlWriter::BeginLine()
+{
+	if ( tagOpen )
+	{
+		Write( ">", 1 );
+		DoLineBreak();
+		tagOpen = false;
+	}
+	else if ( textInline )
+	{
+		DoLineBreak();
+		textInline = false;
+	}
+	DoIndent();
+}
+
+
+void TiXmlWriter::PushDeclaration( const char* version, const char* encoding, const char* standalone )
+{
+	BeginLine();
+	Write( "<?xml ", 6 );
+	if ( version && *version ) {
+		Write( "version=\"", 9 );
+		Write( version );
+		Write( "\" ", 2 );
+	}
+	if ( encoding && *encoding ) {
+		Write( "encoding=\"", 10 );
+		Write( encoding );
+		Write( "\" ", 2 );
+	}
+	if ( standalone && *standalone ) {
+		Write( "standalone=\"", 12 );
+		Write( standalone );
+		Write( "\" ", 2 );
+	}
+	Write( "?>", 2 );
+	DoLineBreak();
+}
+
+
+void TiXmlWriter::OpenElement( const char* name )
+{
+	assert( name );
+	BeginLine();
+	Write( "<", 1 );
+	Write( name );
+
+	names.append( name, strlen( name ) + 1 );
+	++depth;
+	tagOpen = true;
+}
+
+
+void TiXmlWriter::PushAttribute( const char* name, const char* value )
+{
+	assert( tagOpen );
+	if ( !tagOpen )
+		return;
+	if ( !value )
+		value = "";
+
+	// The same quoting as TiXmlAttribute::Print().
+	const char* quote = strchr( value, '\"' ) ? "'" : "\"";
+
+	Write( " ", 1 );
+	WriteEncoded( name );
+	Write( "=", 1 );
+	Write( quote, 1 );
+	WriteEncoded( value );
+	Write( quote, 1 );
+}
+
+
+void TiXmlWriter::PushAttribute( const char* name, int value )
+{
+	char buf [64];
+	#if defined(TIXML_SNPRINTF)		
+		TIXML_SNPRINTF(buf, sizeof(buf), "%d", value);
+	#else
+		sprintf (buf, "%d", value);
+	#endif
+	PushAttribute( name, buf );
+}
+
+
+void TiXmlWriter::PushAttribute( const char* name, double value )
+{
+	char buf [256];
+	#if defined(TIXML_SNPRINTF)		
+		TIXML_SNPRINTF( buf, sizeof(buf), "%g", value);
+	#else
+		sprintf (buf, "%g", value);
+	#endif
+	PushAttribute( name, buf );
+}
+
+
+void TiXmlWriter::PushText( const char* text, bool cdata )
+{
+	if ( !text )
+		text = "";
+	if ( cdata )
+	{
+		BeginLine();
+		Write( "<![CDATA[", 9 );
+		Write( text );
+		Write( "]]>", 3 );
+		DoLineBreak();
+	}
+	else if ( tagOpen )
+	{
+		// Text straight after the start tag stays on its line.
+		Write( ">", 1 );
+		tagOpen = false;
+		WriteEncoded( text );
+		textInline = true;
+	}
+	else
+	{
+		BeginLine();
+		WriteEncoded( text );
+		DoLineBreak();
+	}
+}
+
+
+void TiXmlWriter::PushComment( const char* comment )
+{
+	if ( !comment )
+		comment = "";
+	BeginLine();
+	Write( "<!--", 4 );
+	Write( comment );
+	Write( "-->", 3 );
+	DoLineBreak();
+}
+
+
+void TiXmlWriter::CloseElement()
+{
+	assert( depth > 0 );
+	if ( depth <= 0 )
+		return;
+
+	// Find the name of the element being closed, at the end of the list.
+	size_t start = names.length() - 1;
+	while ( start > 0 && names[start-1] != 0 )
+		--start;
+
+	--depth;
+	if ( tagOpen )
+	{
+		Write( " />", 3 );
+		tagOpen = false;
+	}
+	else
+	{
+		if ( textInline )
+			textInline = false;
+		else
+			DoIndent();
+		Write( "</", 2 );
+		Write( names.c_str() + start, names.length() - 1 - start );
+		Write( ">", 1 );
+	}
+	DoLineBreak();
+	names.resize( start );
+
+	if ( depth == 0 && output.sink )
+		Flush();
+}
+
+
+void TiXmlWriter::Reset()
+{
+	output.buffer.resize( 0 );
+	names.resize( 0 );
+	depth = 0;
+	tagOpen = false;
+	textInline = false;
+}
+
+
+// Prints like TiXmlPrinter, but cuts the text and attribute values around
+// their placeholders, telling the template where each one goes.
+class TiXmlTemplatePrinter : public TiXmlPrinter
+{
+public:
+	TiXmlTemplatePrinter( TiXmlTemplate* _tmpl ) : tmpl( _tmpl ) {}
+
+	TIXML_STRING& Buffer()	{ return output.buffer; }
+
+private:
+	virtual void WriteText( const TiXmlText& text );
+	virtual void WriteAttribute( const TiXmlAttribute& attribute );
+	void WriteValue( const TIXML_STRING& value, bool raw );
+	void WritePart( const char* str, size_t length, bool raw );
+
+	TiXmlTemplate* tmpl;
+};
+
+
+// Finds the next ${name} at or after 'p', and returns where it starts, or
+// null if there isn't one.
+static const char* TiXmlFindPlaceholder( const char* p, const char** name, size_t* length )
+{
+	for( p = strstr( p, "${" ); p; p = strstr( p + 2, "${" ) )
+	{
+		const char* end = strchr( p + 2, '}' );
+		if ( !end )
+			return 0;
+		if ( end > p + 2 )
+		{
+			*name = p + 2;
+			*length = end - *name;
+			return p;
+		}
+	}
+	return 0;
+}
+
+
+void TiXmlTemplatePrinter::WriteText( const TiXmlText& text )
+{
+	WriteValue( text.ValueTStr(), text.Raw() );
+}
+
+
+void TiXmlTemplatePrinter::WriteAttribute( const TiXmlAttribute& attribute )
+{
+	const TIXML_STRING& value = attribute.ValueTStr();
+	if ( !strstr( value.c_str(), "${" ) )
+	{
+		TiXmlPrinter::WriteAttribute( attribute );
+		return;
+	}
+
+	// The values are encoded quotes and all, so either quote will do.
+	const char* quote = ( value.find( '\"' ) == TIXML_STRING::npos ) ? "\"" : "'";
+
+	WriteEncoded( attribute.NameTStr() );
+	Write( "=", 1 );
+	Write( quote, 1 );
+	WriteValue( value, attribute.Raw() );
+	Write( quote, 1 );
+}
+
+
+void TiXmlTemplatePrinter::WriteValue( const TIXML_STRING& value, bool raw )
+{
+	const char* p = value.c_str();
+	const char* name = 0;
+	size_t length = 0;
+	const char* placeholder;
+	while( ( placeholder = TiXmlFindPlaceholder( p, &name, &length ) ) != 0 )
+	{
+		WritePart( p, placeholder - p, raw );
+		tmpl->AddPlaceholder( output.buffer.length(), name, length );
+		p = name + length + 1;
+	}
+	WritePart( p, value.c_str() + value.length() - p, raw );
+}
+
+
+void TiXmlTemplatePrinter::WritePart( const char* str, size_t length, bool raw )
+{
+	if ( raw )
+		Write( str, length );
+	else
+		output.WriteEncoded( str, length );
+}
+
+
+void TiXmlTemplate::Compile( const TiXmlNode& node, const char* indent, const char* lineBreak )
+{
+	text.resize( 0 );
+	names.resize( 0 );
+	pieceCount = 0;
+	slots = 0;
+
+	TiXmlTemplatePrinter printer( this );
+	printer.SetIndent( indent );
+	printer.SetLineBreak( lineBreak );
+	node.Accept( &printer );
+	text.swap( printer.Buffer() );
+}
+
+
+int TiXmlTemplate::FindSlot( const char* name, size_t length ) const
+{
+	const char* p = names.c_str();
+	for( int slot=0; slot<slots; ++slot )
+	{
+		size_t n = strlen( p );
+		if ( n == length && memcmp( p, name, length ) == 0 )
+			return slot;
+		p += n + 1;
+	}
+	return -1;
+}
+
+
+int TiXmlTemplate::Slot( const char* name ) const
+{
+	return name ? FindSlot( name, strlen( name ) ) : -1;
+}
+
+
+const char* TiXmlTemplate::SlotName( int slot ) const
+{
+	if ( slot < 0 || slot >= slots )
+		return 0;
+	const char* p = names.c_str();
+	while( slot-- > 0 )
+		p += strlen( p ) + 1;
+	return p;
+}
+
+
+void TiXmlTemplate::AddPlaceholder( size_t end, const char* name, size_t length )
+{
+	int slot = FindSlot( name, length );
+	if ( slot < 0 )
+	{
+		names.append( name, length );
+		names.append( "", 1 );
+		slot = slots++;
+	}
+
+	if ( pieceCount == pieceCapacity )
+	{
+		int capacity = pieceCapacity ? pieceCapacity * 2 : 16;
+		Piece* grown = new Piece[ capacity ];
+		for( int i=0; i<pieceCount; ++i )
+			grown[i] = pieces[i];
+		delete [] pieces;
+		pieces = grown;
+		pieceCapacity = capacity;
+	}
+	pieces[ pieceCount ].end = end;
+	pieces[ pieceCount ].slot = slot;
+	++pieceCount;
+}
+
+
+void TiXmlTemplate::Render( const char* const* values, TIXML_STRING* out ) const
+{
+	// Enough room for everything, unless the values need encoding.
+	size_t length = text.length();
+	for( int i=0; i<pieceCount; ++i )
+	{
+		if ( values[ pieces[i].slot ] )
+			length += strlen( values[ pieces[i].slot ] );
+	}
+	out->reserve( out->length() + length );
+
+	const char* p = text.c_str();
+	size_t at = 0;
+	for( int i=0; i<pieceCount; ++i )
+	{
+		out->append( p + at, pieces[i].end - at );
+		at = pieces[i].end;
+		const char* value = values[ pieces[i].slot ];
+		if ( value )
+			TiXmlBase::EncodeString( value, strlen( value ), out );
+	}
+	out->append( p + at, text.length() - at );
+}
+
+
+// An attribute of the element being printed, and what it is sorted by.
+class TiXmlCanonicalAttribute
+{
+public:
+	const TiXmlAttribute* attribute;
+	int kind;			// 0 for xmlns, 1 for xmlns:prefix, 2 for the rest
+	const char* uri;	// the namespace of the rest
+	const char* local;	// the name after any prefix
+};
+
+
+// Namespace declarations first, the default one ahead of the rest by prefix,
+// then the other attributes by namespace and local name.
+static int TiXmlCompareCanonical( const void* a, const void* b )
+{
+	const TiXmlCanonicalAttribute* x = (const TiXmlCanonicalAttribute*) a;
+	const TiXmlCanonicalAttribute* y = (const TiXmlCanonicalAttribute*) b;
+	if ( x->kind != y->kind )
+		return x->kind - y->kind;
+	if ( x->kind == 2 )
+	{
+		int order = strcmp( x->uri, y->uri );
+		if ( order )
+			return order;
+	}
+	return strcmp( x->local, y->local );
+}
+
+
+TiXmlCanonicalPrinter::~TiXmlCanonicalPrinter()
+{
+	delete [] attributes;
+}
+
+
+bool TiXmlCanonicalPrinter::VisitEnter( const TiXmlDocument& )
+{
+	depth = 0;
+	afterRoot = false;
+	return true;
+}
+
+
+bool TiXmlCanonicalPrinter::VisitExit( const TiXmlDocument& )
+{
+	if ( output.sink )
+		Flush();
+	return true;
+}
+
+
+bool TiXmlCanonicalPrinter::VisitEnter( const TiXmlElement& element, const TiXmlAttribute* )
+{
+	Write( "<", 1 );
+	Write( element.ValueTStr() );
+
+	int count = CollectAttributes( element );
+	qsort( attributes, count, sizeof( TiXmlCanonicalAttribute ), TiXmlCompareCanonical );
+	for( int i=0; i<count; ++i )
+	{
+		Write( " ", 1 );
+		Write( attributes[i].attribute->NameTStr() );
+		Write( "=\"", 2 );
+		WriteEscaped( attributes[i].attribute->ValueTStr(), true );
+		Write( "\"", 1 );
+	}
+
+	Write( ">", 1 );
+	++depth;
+	return true;
+}
+
+
+bool TiXmlCanonicalPrinter::VisitExit( const TiXmlElement& element )
+{
+	--depth;
+	Write( "</", 2 );
+	Write( element.ValueTStr() );
+	Write( ">", 1 );
+	if ( depth == 0 )
+		afterRoot = true;
+	return true;
+}
+
+
+bool TiXmlCanonicalPrinter::Visit( const TiXmlDeclaration& )
+{
+	return true;
+}
+
+
+bool TiXmlCanonicalPrinter::Visit( const TiXmlText& text )
+{
+	// CDATA is just text; anything outside the document element is white space.
+	if ( depth > 0 )
+		WriteEscaped( text.ValueTStr(), false );
+	return true;
+}
+
+
+bool TiXmlCanonicalPrinter::Visit( const TiXmlComment& comment )
+{
+	if ( comments )
+		WriteMarkup( "<!--", comment.ValueTStr(), "-->" );
+	return true;
+}
+
+
+bool TiXmlCanonicalPrinter::Visit( const TiXmlUnknown& unknown )
+{
+	// Processing instructions are kept, the DOCTYPE and the like are not.
+	if ( unknown.ValueTStr().length() > 0 && unknown.ValueTStr()[0] == '?' )
+		WriteMarkup( "<", unknown.ValueTStr(), ">" );
+	return true;
+}
+
+
+void TiXmlCanonicalPrinter::WriteEscaped( const TIXML_STRING& str, bool attribute )
+{
+	const char* p = str.c_str();
+	const char* end = p + str.length();
+	const char* run = p;
+
+	for( ; p < end; ++p )
+	{
+		const char* entity = 0;
+		switch ( *p )
+		{
+			case '&':	entity = "&amp;";							break;
+			case '<':	entity = "&lt;";							break;
+			case '>':	entity = attribute ? 0 : "&gt;";			break;
+			case '\"':	entity = attribute ? "&quot;" : 0;			break;
+			case '\t':	entity = attribute ? "&#x9;" : 0;			break;
+			case '\n':	entity = attribute ? "&#xA;" : 0;			break;
+			case '\r':	entity = "&#xD;";							break;
+			default:												break;
+		}
+		if ( entity )
+		{
+			Write( run, p - run );
+			Write( entity, strlen( entity ) );
+			run = p + 1;
+		}
+	}
+	Write( run, p - run );
+}
+
+
+// Comments and processing instructions outside the document element go on
+// lines of their own.
+void TiXmlCanonicalPrinter::WriteMarkup( const char* start, const TIXML_STRING& str, const char* end )
+{
+	if ( depth == 0 && afterRoot )
+		Write( "\n", 1 );
+	Write( start, strlen( start ) );
+	Write( str );
+	Write( end, strlen( end ) );
+	if ( depth == 0 && !afterRoot )
+		Write( "\n", 1 );
+}
+
+
+int TiXmlCanonicalPrinter::CollectAttributes( const TiXmlElement& element )
+{
+	int count = 0;
+	const TiXmlAttribute* attribute;
+	for( attribute = element.FirstAttribute(); attribute; attribute = attribute->Next() )
+	{
+		if ( depth == 0 || !Redundant( element, attribute ) )
+			count = AddAttribute( count, element, attribute );
+	}
+	if ( depth > 0 )
+		return count;
+
+	// Printed without its parents, so it brings in the namespaces and the
+	// xml: attributes it gets from them. The nearest declaration wins.
+	for( const TiXmlNode* node = element.Parent(); node && node->AsElement(); node = node->Parent() )
+	{
+		for( attribute = node->AsElement()->FirstAttribute(); attribute; attribute = attribute->Next() )
+		{
+			const char* name = attribute->Name();
+			if (    strcmp( name, "xmlns" ) != 0
+				 && strncmp( name, "xmlns:", 6 ) != 0
+				 && strncmp( name, "xml:", 4 ) != 0 )
+				continue;
+
+			int i = 0;
+			while( i < count && strcmp( attributes[i].attribute->Name(), name ) != 0 )
+				++i;
+			if ( i == count )
+				count = AddAttribute( count, element, attribute );
+		}
+	}
+
+	// An empty default namespace has nothing to undo at the top.
+	int kept = 0;
+	for( int i=0; i<count; ++i )
+	{
+		if ( attributes[i].kind != 0 || *attributes[i].attribute->Value() )
+			attributes[ kept++ ] = attributes[i];
+	}
+	return kept;
+}
+
+
+int TiXmlCanonicalPrinter::AddAttribute( int count, const TiXmlElement& element, const TiXmlAttribute* attribute )
+{
+	if ( count == attributeCapacity )
+	{
+		int capacity = attributeCapacity ? attributeCapacity * 2 : 16;
+		TiXmlCanonicalAttribute* grown = new TiXmlCanonicalAttribute[ capacity ];
+		for( int i=0; i<count; ++i )
+			grown[i] = attributes[i];
+		delete [] attributes;
+		attributes = grown;
+		attributeCapacity = capacity;
+	}
+
+	TiXmlCanonicalAttribute& entry = attributes[ count ];
+	const char* name = attribute->Name();
+	entry.attribute = attribute;
+	entry.uri = "";
+	if ( strcmp( name, "xmlns" ) == 0 )
+	{
+		entry.kind = 0;
+		entry.local = "";
+	}
+	else if ( strncmp( name, "xmlns:", 6 ) == 0 )
+	{
+		entry.kind = 1;
+		entry.local = name + 6;
+	}
+	else
+	{
+		const char* colon = strchr( name, ':' );
+		entry.kind = 2;
+		entry.local = colon ? colon + 1 : name;
+		if ( colon )
+			entry.uri = NamespaceOf( element, name, colon - name );
+	}
+	return count + 1;
+}
+
+
+// The namespace 'prefix' stands for at 'element', or "" if it isn't declared.
+const char* TiXmlCanonicalPrinter::NamespaceOf( const TiXmlElement& element, const char* prefix, size_t length )
+{
+	if ( length == 3 && strncmp( prefix, "xml", 3 ) == 0 )
+		return "http://www.w3.org/XML/1998/namespace";
+
+	lookup = "xmlns:";
+	lookup.append( prefix, length );
+	for( const TiXmlNode* node = &element; node && node->AsElement(); node = node->Parent() )
+	{
+		const char* uri = node->AsElement()->Attribute( lookup.c_str() );
+		if ( uri )
+			return uri;
+	}
+	return "";
+}
+
+
+// True if 'declaration' is a namespace declaration that only says again what
+// the parents of 'element' already have in effect.
+bool TiXmlCanonicalPrinter::Redundant( const TiXmlElement& element, const TiXmlAttribute* declaration )
+{
+	const char* name = declaration->Name();
+	if ( strcmp( name, "xmlns" ) != 0 && strncmp( name, "xmlns:", 6 ) != 0 )
+		return false;
+
+	for( const TiXmlNode* node = element.Parent(); node && node->AsElement(); node = node->Parent() )
+	{
+		const char* value = node->AsElement()->Attribute( name );
+		if ( value )
+			return strcmp( value, declaration->Value() ) == 0;
+	}
+	// An empty default namespace with no other one to undo.
+	return strcmp( name, "xmlns" ) == 0 && !*declaration->Value();
+}
+
+
+void TiXmlCanonicalPrinter::Reset()
+{
+	output.buffer.resize( 0 );
+	depth = 0;
+	afterRoot = false;
+}
+
+
+bool TiXmlFileOutputSink::Write( const char* data, int size )
+{
+	if ( !file )
+		return false;
+	return fwrite( data, 1, size, file ) == (size_t) size;
+}
+
+
+bool TiXmlFdOutputSink::Write( const char* data, int size )
+{
+	if ( fd < 0 )
+		return false;
+	while ( size > 0 )
+	{
+		#if defined( _WIN32 )
+			int count = _write( fd, data, size );
+		#else
+			ssize_t count = write( fd, data, size );
+			if ( count < 0 && errno == EINTR )
+				continue;
+		#endif
+		if ( count <= 0 )
+			return false;
+		data += count;
+		size -= (int) count;
+	}
+	return true;
+}
@@ -47,12 +47,20 @@ distribution.
 	#include <string>
  	#include <iostream>
 	#include <sstream>
+	#include <iterator>
+	#include <cstddef>
 	#define TIXML_STRING		std::string
 #else
 	#include "tinystr.h"
 	#define TIXML_STRING		TiXmlString
 #endif
 
+// TIXML_SLIM_NODES builds a smaller node (and attribute): the row and column
+// of each node in the source, and the user data pointer, are left out. Row()
+// and Column() return 0, and Get/SetUserData() are not available. The parser
+// is a little faster, too, as it doesn't track the location of every node.
+// It must be defined the same way for the library and everything using it.
+
 // Deprecated library function hell. Compilers want to use the
 // new safe versions. This probably doesn't fully address the problem,
 // but it gets closer. There are too many compilers for me to fully
@@ -88,6 +96,8 @@ class TiXmlAttribute;
 class TiXmlText;
 class TiXmlDeclaration;
 class TiXmlParsingData;
+class TiXmlPrintCache;
+class TiXmlCanonicalAttribute;
 
 const int TIXML_MAJOR_VERSION = 2;
 const int TIXML_MINOR_VERSION = 6;
@@ -150,6 +160,28 @@ public:
 	virtual bool Visit( const TiXmlUnknown& /*unknown*/ )			{ return true; }
 };
 
+
+/**
+	A visitor base class for TiXmlNode::Walk(). It has the same methods as
+	TiXmlVisitor, but they are not virtual: a class derived from it hides the
+	ones it is interested in, and Walk() calls them directly, so the compiler
+	can inline them. It can't be used with Accept().
+
+	@sa TiXmlNode::Walk()
+*/
+class TiXmlStaticVisitor
+{
+public:
+	bool VisitEnter( const TiXmlDocument& /*doc*/ )			{ return true; }
+	bool VisitExit( const TiXmlDocument& /*doc*/ )			{ return true; }
+	bool VisitEnter( const TiXmlElement& /*element*/, const TiXmlAttribute* /*firstAttribute*/ )	{ return true; }
+	bool VisitExit( const TiXmlElement& /*element*/ )		{ return true; }
+	bool Visit( const TiXmlDeclaration& /*declaration*/ )	{ return true; }
+	bool Visit( const TiXmlText& /*text*/ )					{ return true; }
+	bool Visit( const TiXmlComment& /*comment*/ )			{ return true; }
+	bool Visit( const TiXmlUnknown& /*unknown*/ )			{ return true; }
+};
+
 // Only used by Attribute::Query functions
 enum 
 { 
@@ -198,7 +230,11 @@ class TiXmlBase
 	friend class TiXmlDocument;
 
 public:
+	#ifdef TIXML_SLIM_NODES
+	TiXmlBase()						{}
+	#else
 	TiXmlBase()	:	userData(0)		{}
+	#endif
 	virtual ~TiXmlBase()			{}
 
 	/**	All TinyXml classes can print themselves to a filestream
@@ -206,7 +242,8 @@ public:
 		in STL mode.) Either or both cfile and str can be null.
 		
 		This is a formatted print, and will insert 
-		tabs and newlines.
+		tabs and newlines. The pieces are written to cfile one at a
+		time, with whatever buffering it already has.
 		
 		(For an unformatted stream, use the << operator.)
 	*/
@@ -217,6 +254,8 @@ public:
 		are provided to set whether or not TinyXml will condense all white space
 		into a single space or not. The default is to condense. Note changing this
 		value is not thread safe.
+
+		TiXmlDocument::SetParseOptions() sets this for one document instead.
 	*/
 	static void SetCondenseWhiteSpace( bool condense )		{ condenseWhiteSpace = condense; }
 
@@ -238,15 +277,21 @@ public:
 
 		There is a minor performance cost to computing the row and column. Computation
 		can be disabled if TiXmlDocument::SetTabSize() is called with 0 as the value.
+		If TIXML_SLIM_NODES is defined, the location isn't stored and these return 0.
 
 		@sa TiXmlDocument::SetTabSize()
 	*/
+	#ifdef TIXML_SLIM_NODES
+	int Row() const			{ return 0; }
+	int Column() const		{ return 0; }
+	#else
 	int Row() const			{ return location.row + 1; }
 	int Column() const		{ return location.col + 1; }	///< See Row()
 
-	void  SetUserData( void* user )			{ userData = user; }	///< Set a pointer to arbitrary user data.
+	void  SetUserData( void* user )			{ userData = user; }	///< Set a pointer to arbitrary user data. (Not with TIXML_SLIM_NODES.)
 	void* GetUserData()						{ return userData; }	///< Get a pointer to arbitrary user data.
 	const void* GetUserData() const 		{ return userData; }	///< Get a pointer to arbitrary user data.
+	#endif
 
 	// Table that returs, for a given lead byte, the total number of bytes
 	// in the UTF-8 sequence.
@@ -260,6 +305,10 @@ public:
 		or they will be transformed into entities!
 	*/
 	static void EncodeString( const TIXML_STRING& str, TIXML_STRING* out );
+	/// Expands entities in the first 'length' characters of 'str'.
+	static void EncodeString( const char* str, size_t length, TIXML_STRING* out );
+	/// True if EncodeString() might change 'str': false means it can be written as it is.
+	static bool NeedsEncoding( const TIXML_STRING& str );
 
 	enum
 	{
@@ -279,6 +328,7 @@ public:
 		TIXML_ERROR_EMBEDDED_NULL,
 		TIXML_ERROR_PARSING_CDATA,
 		TIXML_ERROR_DOCUMENT_TOP_ONLY,
+		TIXML_ERROR_NESTING_TOO_DEEP,
 
 		TIXML_ERROR_STRING_COUNT
 	};
@@ -370,10 +420,22 @@ protected:
 
 	static const char* errorString[ TIXML_ERROR_STRING_COUNT ];
 
+	// Note the source location of this node or attribute, found at 'p', if
+	// it is being kept. (Which it isn't with TIXML_SLIM_NODES.)
+	void StampLocation( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding );
+	// Copy the location and user data to another node or attribute.
+	void CopyLocation( TiXmlBase* target ) const;
+	// Forget the location. The user data is left alone.
+	void ClearLocation();
+	// Forget the location and the user data, for a node being recycled.
+	void ClearLocationAndUserData();
+
+	#ifndef TIXML_SLIM_NODES
 	TiXmlCursor location;
 
     /// Field containing a generic user pointer
 	void*			userData;
+	#endif
 	
 	// None of these methods are reliable for any language except English.
 	// Good for approximation, not great for accuracy.
@@ -411,6 +473,119 @@ private:
 	};
 	static Entity entity[ NUM_ENTITY ];
 	static bool condenseWhiteSpace;
+
+	static void Encode( const char* str, size_t length, TIXML_STRING* out );
+};
+
+
+/**	The iterators returned by TiXmlNode::Children(), TiXmlNode::Elements() and
+	TiXmlElement::Attributes(). They are forward iterators over a TiXmlNode,
+	TiXmlElement or TiXmlAttribute (or a const one) and dereference to a
+	reference to it. They hold one pointer, or for Elements() two, and don't
+	allocate. With TIXML_USE_STL they have the std::iterator_traits typedefs,
+	so they can be given to the standard algorithms.
+*/
+template< class T > class TiXmlNodeIterator
+{
+public:
+	#ifdef TIXML_USE_STL
+	typedef std::forward_iterator_tag	iterator_category;
+	typedef std::ptrdiff_t				difference_type;
+	#endif
+	typedef T							value_type;
+	typedef T*							pointer;
+	typedef T&							reference;
+
+	TiXmlNodeIterator() : node( 0 )				{}
+	explicit TiXmlNodeIterator( T* _node ) : node( _node )	{}
+
+	T& operator*() const	{ return *node; }
+	T* operator->() const	{ return node; }
+	TiXmlNodeIterator& operator++()		{ node = node->NextSibling(); return *this; }
+	TiXmlNodeIterator operator++( int )	{ TiXmlNodeIterator it( *this ); node = node->NextSibling(); return it; }
+	bool operator==( const TiXmlNodeIterator& rhs ) const	{ return node == rhs.node; }
+	bool operator!=( const TiXmlNodeIterator& rhs ) const	{ return node != rhs.node; }
+
+private:
+	T* node;
+};
+
+
+/// An iterator over sibling elements, all of them or those with a name. See TiXmlNodeIterator.
+template< class T > class TiXmlElementIterator
+{
+public:
+	#ifdef TIXML_USE_STL
+	typedef std::forward_iterator_tag	iterator_category;
+	typedef std::ptrdiff_t				difference_type;
+	#endif
+	typedef T							value_type;
+	typedef T*							pointer;
+	typedef T&							reference;
+
+	TiXmlElementIterator() : element( 0 ), name( 0 )	{}
+	TiXmlElementIterator( T* _element, const char* _name ) : element( _element ), name( _name )	{}
+
+	T& operator*() const	{ return *element; }
+	T* operator->() const	{ return element; }
+	TiXmlElementIterator& operator++()		{ Advance(); return *this; }
+	TiXmlElementIterator operator++( int )	{ TiXmlElementIterator it( *this ); Advance(); return it; }
+	bool operator==( const TiXmlElementIterator& rhs ) const	{ return element == rhs.element; }
+	bool operator!=( const TiXmlElementIterator& rhs ) const	{ return element != rhs.element; }
+
+private:
+	void Advance()	{ element = name ? element->NextSiblingElement( name ) : element->NextSiblingElement(); }
+
+	T* element;
+	const char* name;
+};
+
+
+/// An iterator over the attributes of an element. See TiXmlNodeIterator.
+template< class T > class TiXmlAttributeIterator
+{
+public:
+	#ifdef TIXML_USE_STL
+	typedef std::forward_iterator_tag	iterator_category;
+	typedef std::ptrdiff_t				difference_type;
+	#endif
+	typedef T							value_type;
+	typedef T*							pointer;
+	typedef T&							reference;
+
+	TiXmlAttributeIterator() : attribute( 0 )	{}
+	explicit TiXmlAttributeIterator( T* _attribute ) : attribute( _attribute )	{}
+
+	T& operator*() const	{ return *attribute; }
+	T* operator->() const	{ return attribute; }
+	TiXmlAttributeIterator& operator++()		{ attribute = attribute->Next(); return *this; }
+	TiXmlAttributeIterator operator++( int )	{ TiXmlAttributeIterator it( *this ); attribute = attribute->Next(); return it; }
+	bool operator==( const TiXmlAttributeIterator& rhs ) const	{ return attribute == rhs.attribute; }
+	bool operator!=( const TiXmlAttributeIterator& rhs ) const	{ return attribute != rhs.attribute; }
+
+private:
+	T* attribute;
+};
+
+
+/**	A pair of iterators, with the begin() and end() a range based for loop
+	needs:
+	@verbatim
+	for( TiXmlElement& item : root->Elements( "item" ) )
+		...
+	@endverbatim
+*/
+template< class Iterator > class TiXmlRange
+{
+public:
+	TiXmlRange( Iterator _first ) : first( _first )	{}
+
+	Iterator begin() const	{ return first; }
+	Iterator end() const	{ return Iterator(); }
+	bool empty() const		{ return first == Iterator(); }
+
+private:
+	Iterator first;
 };
 
 
@@ -505,16 +680,25 @@ public:
 		Text:		the text string
 		@endverbatim
 	*/
-	void SetValue(const char * _value) { value = _value;}
+	void SetValue(const char * _value) { value = _value; ValueChanged(); }
 
     #ifdef TIXML_USE_STL
 	/// STL std::string form.
-	void SetValue( const std::string& _value )	{ value = _value; }
+	void SetValue( const std::string& _value )	{ value = _value; ValueChanged(); }
 	#endif
 
-	/// Delete all the children of this node. Does not affect 'this'.
+	/** Delete all the children of this node. Does not affect 'this'. It doesn't
+		recurse, so even a very deep tree can't overflow the stack.
+	*/
 	void Clear();
 
+	/** Note that this node has changed, so any output a caching TiXmlPrinter
+		kept for it and its parents is out of date. The methods that change
+		a node call it themselves; it is only needed after changing the tree
+		some other way.
+	*/
+	void Changed();
+
 	/// One step up the DOM.
 	TiXmlNode* Parent()							{ return parent; }
 	const TiXmlNode* Parent() const				{ return parent; }
@@ -575,6 +759,22 @@ public:
 	TiXmlNode* IterateChildren( const std::string& _value, const TiXmlNode* previous ) {	return IterateChildren (_value.c_str (), previous);	}	///< STL std::string form.
 	#endif
 
+	/** The children of this node, as a range for a range based for loop or
+		the standard algorithms:
+		@verbatim
+			for( TiXmlNode& child : parent->Children() )
+		@endverbatim
+	*/
+	inline TiXmlRange< TiXmlNodeIterator< const TiXmlNode > > Children() const;
+	inline TiXmlRange< TiXmlNodeIterator< TiXmlNode > > Children();
+
+	/** The child elements of this node, or (if a value is given) the child
+		elements with that value, as a range. The value is not copied, so it
+		has to outlive the loop.
+	*/
+	inline TiXmlRange< TiXmlElementIterator< const TiXmlElement > > Elements( const char* _value = 0 ) const;
+	inline TiXmlRange< TiXmlElementIterator< TiXmlElement > > Elements( const char* _value = 0 );
+
 	/** Add a new node related to this. Adds a child past the LastChild.
 		Returns a pointer to the new object or NULL if an error occured.
 	*/
@@ -610,6 +810,11 @@ public:
 	/// Delete a child of this node.
 	bool RemoveChild( TiXmlNode* removeThis );
 
+	/** Unlink a child of this node without deleting it. Returns the child, which
+		the caller now owns, or null if it isn't a child of this node.
+	*/
+	TiXmlNode* DetachChild( TiXmlNode* detachThis );
+
 	/// Navigate to a sibling node.
 	const TiXmlNode* PreviousSibling() const			{ return prev; }
 	TiXmlNode* PreviousSibling()						{ return prev; }
@@ -640,6 +845,11 @@ public:
 	/** Convenience function to get through elements.
 		Calls NextSibling and ToElement. Will skip all non-Element
 		nodes. Returns 0 if there is not another element.
+
+		Elements are linked to their element siblings as well, so called on
+		an element this goes straight to the next element without looking
+		at the text, comments and other nodes in between. (Not with
+		TIXML_SLIM_NODES, which leaves the links out.)
 	*/
 	const TiXmlElement* NextSiblingElement() const;
 	TiXmlElement* NextSiblingElement() {
@@ -660,6 +870,23 @@ public:
 	TiXmlElement* NextSiblingElement( const std::string& _value)				{	return NextSiblingElement (_value.c_str ());	}	///< STL std::string form.
 	#endif
 
+	/// Like NextSiblingElement(), but going backwards.
+	const TiXmlElement* PreviousSiblingElement() const;
+	TiXmlElement* PreviousSiblingElement() {
+		return const_cast< TiXmlElement* >( (const_cast< const TiXmlNode* >(this))->PreviousSiblingElement() );
+	}
+
+	/// Like NextSiblingElement(), but going backwards.
+	const TiXmlElement* PreviousSiblingElement( const char * ) const;
+	TiXmlElement* PreviousSiblingElement( const char *_prev ) {
+		return const_cast< TiXmlElement* >( (const_cast< const TiXmlNode* >(this))->PreviousSiblingElement( _prev ) );
+	}
+
+    #ifdef TIXML_USE_STL
+	const TiXmlElement* PreviousSiblingElement( const std::string& _value) const	{	return PreviousSiblingElement (_value.c_str ());	}	///< STL std::string form.
+	TiXmlElement* PreviousSiblingElement( const std::string& _value)				{	return PreviousSiblingElement (_value.c_str ());	}	///< STL std::string form.
+	#endif
+
 	/// Convenience function to get through elements.
 	const TiXmlElement* FirstChildElement()	const;
 	TiXmlElement* FirstChildElement() {
@@ -708,6 +935,24 @@ public:
 	virtual TiXmlText*	            ToText()        { return 0; } ///< Cast to a more defined type. Will return null if not of the requested type.
 	virtual TiXmlDeclaration*       ToDeclaration() { return 0; } ///< Cast to a more defined type. Will return null if not of the requested type.
 
+	/** Cast to a more defined type, like the To methods above, but by checking
+		Type() instead of making a virtual call. Will return null if not of the
+		requested type. These are used by TinyXml's own tree walks.
+	*/
+	inline const TiXmlDocument*    AsDocument()    const;
+	inline const TiXmlElement*     AsElement()     const;	///< See AsDocument()
+	inline const TiXmlComment*     AsComment()     const;	///< See AsDocument()
+	inline const TiXmlUnknown*     AsUnknown()     const;	///< See AsDocument()
+	inline const TiXmlText*        AsText()        const;	///< See AsDocument()
+	inline const TiXmlDeclaration* AsDeclaration() const;	///< See AsDocument()
+
+	inline TiXmlDocument*          AsDocument();		///< See AsDocument()
+	inline TiXmlElement*           AsElement();			///< See AsDocument()
+	inline TiXmlComment*           AsComment();			///< See AsDocument()
+	inline TiXmlUnknown*           AsUnknown();			///< See AsDocument()
+	inline TiXmlText*              AsText();			///< See AsDocument()
+	inline TiXmlDeclaration*       AsDeclaration();		///< See AsDocument()
+
 	/** Create an exact duplicate of this node and return it. The memory must be deleted
 		by the caller. 
 	*/
@@ -737,6 +982,38 @@ public:
 	*/
 	virtual bool Accept( TiXmlVisitor* visitor ) const = 0;
 
+	/** Visit this node and its children like Accept(), but with the visitor's
+		type known at compile time. The visitor can be any class with the
+		methods of TiXmlVisitor (TiXmlStaticVisitor provides the defaults, and a
+		TiXmlVisitor works too); the calls are resolved, and can be inlined, by
+		the compiler instead of being made through two virtual calls per node.
+		Since the calls are looked up in the visitor's own class, a visitor that
+		defines some of the VisitEnter, VisitExit or Visit overloads needs a
+		using declaration to bring in the rest from its base.
+		The tree is walked with a loop, not by recursion, so deep documents
+		don't use up the stack.
+
+		The results are the same as Accept(), except that an Accept() overridden
+		in a class derived from a TinyXml node is not called.
+
+		@verbatim
+		struct CountElements : public TiXmlStaticVisitor {
+			using TiXmlStaticVisitor::VisitEnter;
+			int count;
+			bool VisitEnter( const TiXmlElement&, const TiXmlAttribute* ) { ++count; return true; }
+		};
+		CountElements counter;
+		counter.count = 0;
+		doc.Walk( &counter );
+		@endverbatim
+	*/
+	template< class Visitor > bool Walk( Visitor* visitor ) const;
+
+	// [internal use]
+	// Mark a node the parser made, which is known to be of one of the TinyXml
+	// classes and not of a class derived from one, so Reset() can reuse it.
+	void SetRecyclable()	{ recyclable = true; }
+
 protected:
 	TiXmlNode( NodeType _type );
 
@@ -750,19 +1027,28 @@ protected:
 	#endif
 
 	// Figure out what is at *p, and parse it. Returns null if it is not an xml node.
-	TiXmlNode* Identify( const char* start, TiXmlEncoding encoding );
+	// The parsing data, if given, saves finding the document from the parents.
+	TiXmlNode* Identify( const char* start, TiXmlEncoding encoding, TiXmlParsingData* data = 0 );
 
-	TiXmlNode*		parent;
-	NodeType		type;
+	// Keep the element sibling links up to date: LinkElement after 'node' is put
+	// in to a list of children, UnlinkElement before it is taken out.
+	static void LinkElement( TiXmlNode* node );
+	static void UnlinkElement( TiXmlNode* node );
 
+	// Called by SetValue(): works out 'plain' for text, and calls Changed().
+	void ValueChanged();
+
+	// The type is last, so its padding can be reused by the derived classes.
+	TiXmlNode*		parent;
 	TiXmlNode*		firstChild;
 	TiXmlNode*		lastChild;
-
-	TIXML_STRING	value;
-
 	TiXmlNode*		prev;
 	TiXmlNode*		next;
 
+	TIXML_STRING	value;
+	NodeType		type;
+	bool			recyclable;		// see SetRecyclable()
+
 private:
 	TiXmlNode( const TiXmlNode& );				// not implemented.
 	void operator=( const TiXmlNode& base );	// not allowed.
@@ -779,13 +1065,17 @@ private:
 class TiXmlAttribute : public TiXmlBase
 {
 	friend class TiXmlAttributeSet;
+	friend class TiXmlDocument;
+	friend class TiXmlPrinter;
 
 public:
 	/// Construct an empty attribute.
 	TiXmlAttribute() : TiXmlBase()
 	{
-		document = 0;
+		owner = 0;
 		prev = next = 0;
+		raw = false;
+		plain = true;
 	}
 
 	#ifdef TIXML_USE_STL
@@ -794,8 +1084,10 @@ public:
 	{
 		name = _name;
 		value = _value;
-		document = 0;
+		owner = 0;
 		prev = next = 0;
+		raw = false;
+		plain = !NeedsEncoding( value );
 	}
 	#endif
 
@@ -804,8 +1096,10 @@ public:
 	{
 		name = _name;
 		value = _value;
-		document = 0;
+		owner = 0;
 		prev = next = 0;
+		raw = false;
+		plain = !NeedsEncoding( value );
 	}
 
 	const char*		Name()  const		{ return name.c_str(); }		///< Return the name of this attribute.
@@ -818,6 +1112,7 @@ public:
 
 	// Get the tinyxml string representation
 	const TIXML_STRING& NameTStr() const { return name; }
+	const TIXML_STRING& ValueTStr() const { return value; }
 
 	/** QueryIntValue examines the value string. It is an alternative to the
 		IntValue() method with richer error checking.
@@ -832,19 +1127,28 @@ public:
 	/// QueryDoubleValue examines the value string. See QueryIntValue().
 	int QueryDoubleValue( double* _value ) const;
 
-	void SetName( const char* _name )	{ name = _name; }				///< Set the name of this attribute.
-	void SetValue( const char* _value )	{ value = _value; }				///< Set the value.
+	void SetName( const char* _name )	{ name = _name; Changed(); }	///< Set the name of this attribute.
+	void SetValue( const char* _value )	{ value = _value; plain = !NeedsEncoding( value ); Changed(); }	///< Set the value.
 
 	void SetIntValue( int _value );										///< Set the value from an integer.
 	void SetDoubleValue( double _value );								///< Set the value from a double.
 
     #ifdef TIXML_USE_STL
 	/// STL std::string form.
-	void SetName( const std::string& _name )	{ name = _name; }	
+	void SetName( const std::string& _name )	{ name = _name; Changed(); }	
 	/// STL std::string form.	
-	void SetValue( const std::string& _value )	{ value = _value; }
+	void SetValue( const std::string& _value )	{ value = _value; plain = !NeedsEncoding( value ); Changed(); }
 	#endif
 
+	/** Print the value exactly as it is, without turning '&', '<' and the
+		like in to entities. For values already escaped, or known to be
+		safe, such as generated identifiers. A raw value that isn't valid
+		XML gives output that isn't either.
+	*/
+	void SetRaw( bool _raw )			{ raw = _raw; Changed(); }
+	/// Whether the value is printed without encoding. See SetRaw().
+	bool Raw() const					{ return raw; }
+
 	/// Get the next sibling attribute in the DOM. Returns null at end.
 	const TiXmlAttribute* Next() const;
 	TiXmlAttribute* Next() {
@@ -873,18 +1177,22 @@ public:
 	void Print( FILE* cfile, int depth, TIXML_STRING* str ) const;
 
 	// [internal use]
-	// Set the document pointer so the attribute can report errors.
-	void SetDocument( TiXmlDocument* doc )	{ document = doc; }
+	// Set the element the attribute belongs to, which is told when it changes.
+	void SetOwner( TiXmlElement* element )	{ owner = element; }
 
 private:
 	TiXmlAttribute( const TiXmlAttribute& );				// not implemented.
 	void operator=( const TiXmlAttribute& base );	// not allowed.
 
-	TiXmlDocument*	document;	// A pointer back to a document, for error reporting.
+	void Changed();
+
+	TiXmlElement*	owner;		// The element the attribute is in, if any.
 	TIXML_STRING name;
 	TIXML_STRING value;
 	TiXmlAttribute*	prev;
 	TiXmlAttribute*	next;
+	bool			raw;
+	bool			plain;		// the value is known to have nothing to encode
 };
 
 
@@ -909,10 +1217,10 @@ public:
 	void Add( TiXmlAttribute* attribute );
 	void Remove( TiXmlAttribute* attribute );
 
-	const TiXmlAttribute* First()	const	{ return ( sentinel.next == &sentinel ) ? 0 : sentinel.next; }
-	TiXmlAttribute* First()					{ return ( sentinel.next == &sentinel ) ? 0 : sentinel.next; }
-	const TiXmlAttribute* Last() const		{ return ( sentinel.prev == &sentinel ) ? 0 : sentinel.prev; }
-	TiXmlAttribute* Last()					{ return ( sentinel.prev == &sentinel ) ? 0 : sentinel.prev; }
+	const TiXmlAttribute* First()	const	{ return first; }
+	TiXmlAttribute* First()					{ return first; }
+	const TiXmlAttribute* Last() const		{ return last; }
+	TiXmlAttribute* Last()					{ return last; }
 
 	TiXmlAttribute*	Find( const char* _name ) const;
 	TiXmlAttribute* FindOrCreate( const char* _name );
@@ -924,12 +1232,13 @@ public:
 
 
 private:
-	//*ME:	Because of hidden/disabled copy-construktor in TiXmlAttribute (sentinel-element),
-	//*ME:	this class must be also use a hidden/disabled copy-constructor !!!
 	TiXmlAttributeSet( const TiXmlAttributeSet& );	// not allowed
 	void operator=( const TiXmlAttributeSet& );	// not allowed (as TiXmlAttribute)
 
-	TiXmlAttribute sentinel;
+	// A plain, null terminated, doubly linked list. (It used to be circular
+	// through a sentinel attribute, which made every element much bigger.)
+	TiXmlAttribute* first;
+	TiXmlAttribute* last;
 };
 
 
@@ -939,6 +1248,10 @@ private:
 */
 class TiXmlElement : public TiXmlNode
 {
+	friend class TiXmlNode;
+	friend class TiXmlDocument;
+	friend class TiXmlPrinter;
+
 public:
 	/// Construct an element.
 	TiXmlElement (const char * in_value);
@@ -1079,6 +1392,14 @@ public:
 	const TiXmlAttribute* LastAttribute()	const 	{ return attributeSet.Last(); }		///< Access the last attribute in this element.
 	TiXmlAttribute* LastAttribute()					{ return attributeSet.Last(); }
 
+	/// The attributes of this element, as a range. See TiXmlNode::Children().
+	TiXmlRange< TiXmlAttributeIterator< const TiXmlAttribute > > Attributes() const {
+		return TiXmlRange< TiXmlAttributeIterator< const TiXmlAttribute > >( TiXmlAttributeIterator< const TiXmlAttribute >( attributeSet.First() ) );
+	}
+	TiXmlRange< TiXmlAttributeIterator< TiXmlAttribute > > Attributes() {
+		return TiXmlRange< TiXmlAttributeIterator< TiXmlAttribute > >( TiXmlAttributeIterator< TiXmlAttribute >( attributeSet.First() ) );
+	}
+
 	/** Convenience function for easy access to the text inside an element. Although easy
 		and concise, GetText() is limited compared to getting the TiXmlText child
 		and accessing it directly.
@@ -1146,7 +1467,23 @@ protected:
 	const char* ReadValue( const char* in, TiXmlParsingData* prevData, TiXmlEncoding encoding );
 
 private:
+	#ifndef TIXML_SLIM_NODES
+	// Set when the element, or anything in it, may have changed since it was
+	// last printed by a caching TiXmlPrinter. A stale element has no
+	// printCache, and nor do the elements it is in. (First, so it can go in
+	// the padding at the end of TiXmlNode.)
+	mutable bool stale;
+	#endif
+
 	TiXmlAttributeSet attributeSet;
+
+	#ifndef TIXML_SLIM_NODES
+	// The element siblings either side, skipping the other nodes.
+	TiXmlElement* prevElement;
+	TiXmlElement* nextElement;
+	// The output of a caching TiXmlPrinter, kept while the element is not stale.
+	mutable TiXmlPrintCache* printCache;
+	#endif
 };
 
 
@@ -1204,7 +1541,10 @@ private:
 */
 class TiXmlText : public TiXmlNode
 {
+	friend class TiXmlNode;
 	friend class TiXmlElement;
+	friend class TiXmlDocument;
+	friend class TiXmlPrinter;
 public:
 	/** Constructor for text element. By default, it is treated as 
 		normal, encoded text. If you want it be output as a CDATA text
@@ -1214,6 +1554,7 @@ public:
 	{
 		SetValue( initValue );
 		cdata = false;
+		raw = false;
 	}
 	virtual ~TiXmlText() {}
 
@@ -1223,6 +1564,7 @@ public:
 	{
 		SetValue( initValue );
 		cdata = false;
+		raw = false;
 	}
 	#endif
 
@@ -1235,7 +1577,16 @@ public:
 	/// Queries whether this represents text using a CDATA section.
 	bool CDATA() const				{ return cdata; }
 	/// Turns on or off a CDATA representation of text.
-	void SetCDATA( bool _cdata )	{ cdata = _cdata; }
+	void SetCDATA( bool _cdata )	{ cdata = _cdata; Changed(); }
+
+	/** Print the text exactly as it is, without turning '&', '<' and the
+		like in to entities: for text that is already escaped, or is a
+		fragment of markup to be passed through. It is up to the caller
+		that the result is well formed. CDATA text is never encoded anyway.
+	*/
+	void SetRaw( bool _raw )		{ raw = _raw; Changed(); }
+	/// Whether the text is printed without encoding. See SetRaw().
+	bool Raw() const				{ return raw; }
 
 	virtual const char* Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding );
 
@@ -1259,6 +1610,8 @@ protected :
 
 private:
 	bool cdata;			// true if this should be input and output as a CDATA style text element
+	bool raw;			// true if the text is printed as it is, see SetRaw()
+	bool plain;			// the value has nothing to encode; found when set, not parsed
 };
 
 
@@ -1379,9 +1732,209 @@ private:
 };
 
 
+/** A source of bytes for TiXmlDocument::LoadFile(). The document pulls
+	the data through Read() a block at a time, normalizing the line endings
+	of each block as it arrives, so a decompressor or decrypting reader can
+	be plugged in without first writing its output somewhere else.
+
+	@verbatim
+	class MyDecryptor : public TiXmlInputSource
+	{
+	public:
+		virtual int Read( char* buffer, int size ) { ... }
+	};
+
+	MyDecryptor source( ... );
+	doc.LoadFile( &source );
+	@endverbatim
+
+	TinyXML provides sources for a FILE*, a file descriptor, a block of
+	memory, and a memory mapped file.
+*/
+class TiXmlInputSource
+{
+public:
+	virtual ~TiXmlInputSource()	{}
+
+	/** Read up to 'size' bytes in to 'buffer'. Returns the number of bytes
+		read, 0 at the end of the input, or -1 if there was an error.
+	*/
+	virtual int Read( char* buffer, int size ) = 0;
+
+	/** The number of bytes left to Read(), if it is known, else -1. It is
+		only a hint, used to allocate the document buffer once up front.
+	*/
+	virtual long Size() const						{ return -1; }
+
+	/** All of the input, Size() bytes followed by a null, if the source
+		already has it in memory that way; else null. LoadFile() then parses
+		it where it is instead of Read()ing it in to a buffer of its own.
+	*/
+	virtual const char* Data() const				{ return 0; }
+};
+
+
+/// Reads from a FILE*, starting at the current file position.
+class TiXmlFileInputSource : public TiXmlInputSource
+{
+public:
+	TiXmlFileInputSource( FILE* file );
+
+	virtual int Read( char* buffer, int bufferSize );
+	virtual long Size() const						{ return size; }
+
+private:
+	TiXmlFileInputSource( const TiXmlFileInputSource& );	// not implemented.
+	void operator=( const TiXmlFileInputSource& );		// not allowed.
+
+	FILE* file;
+	long size;
+};
+
+
+/// Reads from a file descriptor, starting at its current position. The descriptor is not closed.
+class TiXmlFdInputSource : public TiXmlInputSource
+{
+public:
+	TiXmlFdInputSource( int fd );
+
+	virtual int Read( char* buffer, int bufferSize );
+	virtual long Size() const						{ return size; }
+
+private:
+	TiXmlFdInputSource( const TiXmlFdInputSource& );	// not implemented.
+	void operator=( const TiXmlFdInputSource& );		// not allowed.
+
+	int fd;
+	long size;
+};
+
+
+/// Reads from a block of memory, which must stay valid while it is read.
+class TiXmlMemoryInputSource : public TiXmlInputSource
+{
+public:
+	TiXmlMemoryInputSource( const void* data, long length ) : data( (const char*) data ), length( length ), pos( 0 ) {}
+
+	virtual int Read( char* buffer, int bufferSize );
+	virtual long Size() const						{ return length - pos; }
+
+private:
+	TiXmlMemoryInputSource( const TiXmlMemoryInputSource& );	// not implemented.
+	void operator=( const TiXmlMemoryInputSource& );			// not allowed.
+
+	const char* data;
+	long length;
+	long pos;
+};
+
+
+/** Maps a file in to memory and reads from the mapping. Check IsOpen()
+	(or just call LoadFile(), which will report the error) to find out
+	if the file could be mapped. LoadFile() parses the mapping in place,
+	without copying it, unless the file has CR line endings to convert.
+*/
+class TiXmlMappedInputSource : public TiXmlInputSource
+{
+public:
+	TiXmlMappedInputSource( const char* filename );
+	virtual ~TiXmlMappedInputSource();
+
+	/// True if the file was opened and mapped.
+	bool IsOpen() const								{ return data != 0 || ( opened && length == 0 ); }
+
+	virtual int Read( char* buffer, int bufferSize );
+	virtual long Size() const						{ return IsOpen() ? length - pos : -1; }
+	virtual const char* Data() const				{ return ( data && terminated && pos == 0 ) ? data : 0; }
+
+private:
+	TiXmlMappedInputSource( const TiXmlMappedInputSource& );	// not implemented.
+	void operator=( const TiXmlMappedInputSource& );			// not allowed.
+
+	const char* data;
+	long length;
+	long pos;
+	size_t mapped;		// the length of the mapping, which can run past the file
+	bool opened;
+	bool terminated;	// the mapping has a null after the file
+};
+
+
+#ifdef TIXML_USE_ZLIB
+/** Reads a gzip compressed file, decompressing it a block at a time as
+	the document asks for it. A file that isn't compressed is read as is.
+	Only available if TIXML_USE_ZLIB is defined (and zlib is linked in.)
+*/
+class TiXmlGzInputSource : public TiXmlInputSource
+{
+public:
+	TiXmlGzInputSource( const char* filename );
+	virtual ~TiXmlGzInputSource();
+
+	/// True if the file was opened.
+	bool IsOpen() const								{ return gz != 0; }
+
+	virtual int Read( char* buffer, int bufferSize );
+	virtual long Size() const						{ return size; }
+
+private:
+	TiXmlGzInputSource( const TiXmlGzInputSource& );	// not implemented.
+	void operator=( const TiXmlGzInputSource& );		// not allowed.
+
+	void* gz;		// the zlib gzFile
+	long size;		// the uncompressed size, from the gzip trailer, or -1
+};
+#endif
+
+
+/// How Parse() and LoadFile() treat white space. See TiXmlParseOptions.
+enum TiXmlWhiteSpace
+{
+	TIXML_WHITESPACE_DEFAULT,		///< Follow TiXmlBase::IsWhiteSpaceCondensed() at the time of the parse.
+	TIXML_WHITESPACE_CONDENSE,		///< Condense runs of white space in text to one space.
+	TIXML_WHITESPACE_PRESERVE		///< Keep all white space in text.
+};
+
+
+/**	Settings for parsing in to one document, set with
+	TiXmlDocument::SetParseOptions(). Unlike the global
+	TiXmlBase::SetCondenseWhiteSpace(), these belong to the document, so
+	threads parsing different documents can use different settings.
+
+	The encoding isn't here: it is given to each Parse() or LoadFile() call.
+	@verbatim
+	TiXmlParseOptions options;
+	options.whiteSpace = TIXML_WHITESPACE_PRESERVE;
+	options.keepComments = false;
+	options.maxDepth = 64;
+	doc.SetParseOptions( options );
+	@endverbatim
+*/
+class TiXmlParseOptions
+{
+public:
+	TiXmlParseOptions() : whiteSpace( TIXML_WHITESPACE_DEFAULT ), tabSize( 4 ), keepComments( true ), maxDepth( 0 )	{}
+
+	TiXmlWhiteSpace whiteSpace;	///< How to treat white space in text.
+	int tabSize;				///< The tab size for row and column tracking, 0 to turn it off. See TiXmlDocument::SetTabSize().
+	bool keepComments;			///< If false, comments are skipped instead of being added to the document.
+	int maxDepth;				///< The deepest elements may be nested, or 0 for no limit. Deeper gives TIXML_ERROR_NESTING_TOO_DEEP.
+};
+
+
 /** Always the top level node. A document binds together all the
 	XML pieces. It can be saved, loaded, and printed to the screen.
 	The 'value' of a document node is the xml file name.
+
+	Any number of threads can read one document at the same time: all the
+	const methods (finding nodes and attributes, reading values and text,
+	Accept() and Walk() with a visitor per thread, Print(), Clone() and
+	operator<<) are free of shared, changing state. Nothing may change the
+	document meanwhile; parsing, loading, Reset() and the non-const methods
+	need the document to themselves, and so does a TiXmlPrinter with
+	SetCaching() turned on. Separate documents can be used by
+	separate threads freely, as long as they use TiXmlParseOptions rather
+	than changing TiXmlBase::SetCondenseWhiteSpace() while others parse.
 */
 class TiXmlDocument : public TiXmlNode
 {
@@ -1399,7 +1952,7 @@ public:
 	TiXmlDocument( const TiXmlDocument& copy );
 	TiXmlDocument& operator=( const TiXmlDocument& copy );
 
-	virtual ~TiXmlDocument() {}
+	virtual ~TiXmlDocument();
 
 	/** Load a file using the current document value.
 		Returns true if successful. Will delete any existing
@@ -1410,7 +1963,9 @@ public:
 	bool SaveFile() const;
 	/// Load a file using the given filename. Returns true if successful.
 	bool LoadFile( const char * filename, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
-	/// Save a file using the given filename. Returns true if successful.
+	/** Save a file using the given filename. Returns true if successful.
+		The file is given a 64k buffer, so it is written in large blocks.
+	*/
 	bool SaveFile( const char * filename ) const;
 	/** Load a file using the given FILE*. Returns true if successful. Note that this method
 		doesn't stream - the entire object pointed at by the FILE*
@@ -1418,7 +1973,14 @@ public:
 		file location. Streaming may be added in the future.
 	*/
 	bool LoadFile( FILE*, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
-	/// Save a file using the given FILE*. Returns true if successful.
+	/** Load a document from any TiXmlInputSource, reading it until Read()
+		reports the end of the input. Returns true if successful.
+	*/
+	bool LoadFile( TiXmlInputSource* source, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+	/** Save a file using the given FILE*. Returns true if successful.
+		The output is written a piece at a time, with whatever buffering the
+		FILE already has; call setvbuf() on it first for larger writes.
+	*/
 	bool SaveFile( FILE* ) const;
 
 	#ifdef TIXML_USE_STL
@@ -1432,6 +1994,37 @@ public:
 	}
 	#endif
 
+	#ifdef TIXML_USE_ZLIB
+	/** Load a gzip compressed file. The file is decompressed straight in to
+		the document's buffer; no temporary file is needed. Uncompressed files
+		load as well. Returns true if successful. (Requires TIXML_USE_ZLIB.)
+	*/
+	bool LoadGzFile( const char* filename, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+	/** Save a gzip compressed file. The level is the zlib compression level,
+		from 1 (fastest) to 9 (smallest), or -1 for the zlib default.
+		Returns true if successful. (Requires TIXML_USE_ZLIB.)
+
+		The document is compressed as it is printed, by a TiXmlPrinter, so
+		it is laid out the way TiXmlPrinter lays it out rather than the way
+		SaveFile() does: uncompressed, the two files differ around CDATA
+		sections and in elements that mix text with other nodes. Print()
+		overrides are not called. To compress exactly what SaveFile() writes,
+		save to a file and compress that.
+	*/
+	bool SaveGzFile( const char* filename, int level = -1 ) const;
+
+	#ifdef TIXML_USE_STL
+	bool LoadGzFile( const std::string& filename, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING )		///< STL std::string version.
+	{
+		return LoadGzFile( filename.c_str(), encoding );
+	}
+	bool SaveGzFile( const std::string& filename, int level = -1 ) const		///< STL std::string version.
+	{
+		return SaveGzFile( filename.c_str(), level );
+	}
+	#endif
+	#endif
+
 	/** Parse the given null terminated block of xml data. Passing in an encoding to this
 		method (either TIXML_ENCODING_LEGACY or TIXML_ENCODING_UTF8 will force TinyXml
 		to use that encoding, regardless of what TinyXml might otherwise try to detect.
@@ -1494,9 +2087,29 @@ public:
 
 		@sa Row, Column
 	*/
-	void SetTabSize( int _tabsize )		{ tabsize = _tabsize; }
+	void SetTabSize( int _tabsize )		{ parseOptions.tabSize = _tabsize; }
+
+	int TabSize() const	{ return parseOptions.tabSize; }
+
+	/** Set the options for the following Parse() and LoadFile() calls. These
+		include the tab size, so this replaces SetTabSize().
+	*/
+	void SetParseOptions( const TiXmlParseOptions& options )	{ parseOptions = options; }
 
-	int TabSize() const	{ return tabsize; }
+	/// The options Parse() and LoadFile() use. See SetParseOptions().
+	const TiXmlParseOptions& ParseOptions() const	{ return parseOptions; }
+
+	/** Delete all the contents of the document, like Clear(), but hold on to
+		the nodes and attributes, with their string buffers, for the next Parse()
+		or LoadFile() to reuse. Parsing a stream of similar messages in to one
+		document this way settles down to no heap allocation at all. The error
+		state is cleared as well. Only nodes the parser made are kept; the ones
+		added through the API, which may be of classes derived from the TinyXml
+		ones, are deleted.
+	*/
+	void Reset();
+	/// Free the nodes and attributes held on to by Reset().
+	void ReleaseCache();
 
 	/** If you have handled the error, it can be reset with this call. The error
 		state is automatically cleared if you Parse a new XML block.
@@ -1521,6 +2134,14 @@ public:
 	virtual void Print( FILE* cfile, int depth = 0 ) const;
 	// [internal use]
 	void SetError( int err, const char* errorLocation, TiXmlParsingData* prevData, TiXmlEncoding encoding );
+	// [internal use]
+	bool UseMicrosoftBOM() const			{ return useMicrosoftBOM; }
+	// [internal use] An empty node or attribute kept by Reset(), or null if there isn't one.
+	TiXmlNode* CachedNode( TiXmlNode::NodeType type );
+	TiXmlAttribute* CachedAttribute();
+	// [internal use] Keep a node (and all its children) or attribute that is no longer needed.
+	void Recycle( TiXmlNode* node );
+	void Recycle( TiXmlAttribute* attribute );
 
 	virtual const TiXmlDocument*    ToDocument()    const { return this; } ///< Cast to a more defined type. Will return null not of the requested type.
 	virtual TiXmlDocument*          ToDocument()          { return this; } ///< Cast to a more defined type. Will return null not of the requested type.
@@ -1538,16 +2159,106 @@ protected :
 
 private:
 	void CopyTo( TiXmlDocument* target ) const;
+	void InitCache();
 
 	bool error;
 	int  errorId;
 	TIXML_STRING errorDesc;
-	int tabsize;
+	TiXmlParseOptions parseOptions;
 	TiXmlCursor errorLocation;
 	bool useMicrosoftBOM;		// the UTF-8 BOM were found when read. Note this, and try to write.
+
+	// Nodes and attributes kept by Reset(), linked through their 'next' pointers.
+	TiXmlNode* freeNodes[ TiXmlNode::TINYXML_TYPECOUNT ];
+	TiXmlAttribute* freeAttributes;
 };
 
 
+// The node classes are complete here, so the type checked casts can be defined.
+inline const TiXmlDocument* TiXmlNode::AsDocument() const			{ return type == TINYXML_DOCUMENT ? static_cast< const TiXmlDocument* >( this ) : 0; }
+inline const TiXmlElement* TiXmlNode::AsElement() const				{ return type == TINYXML_ELEMENT ? static_cast< const TiXmlElement* >( this ) : 0; }
+inline const TiXmlComment* TiXmlNode::AsComment() const				{ return type == TINYXML_COMMENT ? static_cast< const TiXmlComment* >( this ) : 0; }
+inline const TiXmlUnknown* TiXmlNode::AsUnknown() const				{ return type == TINYXML_UNKNOWN ? static_cast< const TiXmlUnknown* >( this ) : 0; }
+inline const TiXmlText* TiXmlNode::AsText() const					{ return type == TINYXML_TEXT ? static_cast< const TiXmlText* >( this ) : 0; }
+inline const TiXmlDeclaration* TiXmlNode::AsDeclaration() const		{ return type == TINYXML_DECLARATION ? static_cast< const TiXmlDeclaration* >( this ) : 0; }
+
+inline TiXmlDocument* TiXmlNode::AsDocument()			{ return type == TINYXML_DOCUMENT ? static_cast< TiXmlDocument* >( this ) : 0; }
+inline TiXmlElement* TiXmlNode::AsElement()				{ return type == TINYXML_ELEMENT ? static_cast< TiXmlElement* >( this ) : 0; }
+inline TiXmlComment* TiXmlNode::AsComment()				{ return type == TINYXML_COMMENT ? static_cast< TiXmlComment* >( this ) : 0; }
+inline TiXmlUnknown* TiXmlNode::AsUnknown()				{ return type == TINYXML_UNKNOWN ? static_cast< TiXmlUnknown* >( this ) : 0; }
+inline TiXmlText* TiXmlNode::AsText()					{ return type == TINYXML_TEXT ? static_cast< TiXmlText* >( this ) : 0; }
+inline TiXmlDeclaration* TiXmlNode::AsDeclaration()		{ return type == TINYXML_DECLARATION ? static_cast< TiXmlDeclaration* >( this ) : 0; }
+
+inline TiXmlRange< TiXmlNodeIterator< const TiXmlNode > > TiXmlNode::Children() const {
+	return TiXmlRange< TiXmlNodeIterator< const TiXmlNode > >( TiXmlNodeIterator< const TiXmlNode >( firstChild ) );
+}
+inline TiXmlRange< TiXmlNodeIterator< TiXmlNode > > TiXmlNode::Children() {
+	return TiXmlRange< TiXmlNodeIterator< TiXmlNode > >( TiXmlNodeIterator< TiXmlNode >( firstChild ) );
+}
+inline TiXmlRange< TiXmlElementIterator< const TiXmlElement > > TiXmlNode::Elements( const char* _value ) const {
+	const TiXmlElement* first = _value ? FirstChildElement( _value ) : FirstChildElement();
+	return TiXmlRange< TiXmlElementIterator< const TiXmlElement > >( TiXmlElementIterator< const TiXmlElement >( first, _value ) );
+}
+inline TiXmlRange< TiXmlElementIterator< TiXmlElement > > TiXmlNode::Elements( const char* _value ) {
+	TiXmlElement* first = _value ? FirstChildElement( _value ) : FirstChildElement();
+	return TiXmlRange< TiXmlElementIterator< TiXmlElement > >( TiXmlElementIterator< TiXmlElement >( first, _value ) );
+}
+
+
+template< class Visitor > bool TiXmlNode::Walk( Visitor* visitor ) const
+{
+	const TiXmlNode* node = this;
+	bool result;
+
+	for( ;; )
+	{
+		// Enter the node. Containers continue down in to their first child.
+		switch ( node->type )
+		{
+			case TINYXML_DOCUMENT:
+				if ( visitor->VisitEnter( *static_cast< const TiXmlDocument* >( node ) ) && node->firstChild ) {
+					node = node->firstChild;
+					continue;
+				}
+				result = visitor->VisitExit( *static_cast< const TiXmlDocument* >( node ) );
+				break;
+			case TINYXML_ELEMENT:
+			{
+				const TiXmlElement* element = static_cast< const TiXmlElement* >( node );
+				if ( visitor->VisitEnter( *element, element->FirstAttribute() ) && node->firstChild ) {
+					node = node->firstChild;
+					continue;
+				}
+				result = visitor->VisitExit( *element );
+				break;
+			}
+			case TINYXML_COMMENT:		result = visitor->Visit( *static_cast< const TiXmlComment* >( node ) );		break;
+			case TINYXML_UNKNOWN:		result = visitor->Visit( *static_cast< const TiXmlUnknown* >( node ) );		break;
+			case TINYXML_TEXT:			result = visitor->Visit( *static_cast< const TiXmlText* >( node ) );		break;
+			case TINYXML_DECLARATION:	result = visitor->Visit( *static_cast< const TiXmlDeclaration* >( node ) );	break;
+			default:					result = true;	break;
+		}
+
+		// The node is done. Move to its sibling, or (if there isn't one, or the
+		// visitor said stop) leave the parent, as many times as needed.
+		for( ;; )
+		{
+			if ( node == this )
+				return result;
+			if ( result && node->next ) {
+				node = node->next;
+				break;
+			}
+			node = node->parent;
+			if ( node->type == TINYXML_DOCUMENT )
+				result = visitor->VisitExit( *static_cast< const TiXmlDocument* >( node ) );
+			else
+				result = visitor->VisitExit( *static_cast< const TiXmlElement* >( node ) );
+		}
+	}
+}
+
+
 /**
 	A TiXmlHandle is a class that wraps a node pointer with null checks; this is
 	an incredibly useful thing. Note that TiXmlHandle is not part of the TinyXml
@@ -1678,13 +2389,13 @@ public:
 	TiXmlNode* ToNode() const			{ return node; } 
 	/** Return the handle as a TiXmlElement. This may return null.
 	*/
-	TiXmlElement* ToElement() const		{ return ( ( node && node->ToElement() ) ? node->ToElement() : 0 ); }
+	TiXmlElement* ToElement() const		{ return ( node ? node->AsElement() : 0 ); }
 	/**	Return the handle as a TiXmlText. This may return null.
 	*/
-	TiXmlText* ToText() const			{ return ( ( node && node->ToText() ) ? node->ToText() : 0 ); }
+	TiXmlText* ToText() const			{ return ( node ? node->AsText() : 0 ); }
 	/** Return the handle as a TiXmlUnknown. This may return null.
 	*/
-	TiXmlUnknown* ToUnknown() const		{ return ( ( node && node->ToUnknown() ) ? node->ToUnknown() : 0 ); }
+	TiXmlUnknown* ToUnknown() const		{ return ( node ? node->AsUnknown() : 0 ); }
 
 	/** @deprecated use ToNode. 
 		Return the handle as a TiXmlNode. This may return null.
@@ -1708,6 +2419,105 @@ private:
 };
 
 
+/**	Where a TiXmlPrinter sends its output, if it is given one with
+	TiXmlPrinter::SetSink(). The printer passes the output on a chunk at
+	a time as it is made, so the whole document is never in memory at
+	once. Derive from it to send the output somewhere else, such as a
+	socket:
+	@verbatim
+	class MySocketSink : public TiXmlOutputSink
+	{
+	public:
+		virtual bool Write( const char* data, int size ) { ... }
+	};
+
+	MySocketSink sink( ... );
+	TiXmlPrinter printer;
+	printer.SetSink( &sink );
+	doc.Accept( &printer );
+	@endverbatim
+
+	TinyXML provides sinks for a FILE* and a file descriptor.
+*/
+class TiXmlOutputSink
+{
+public:
+	virtual ~TiXmlOutputSink()	{}
+
+	/// Write all 'size' bytes of 'data'. Returns false if there was an error.
+	virtual bool Write( const char* data, int size ) = 0;
+};
+
+
+/// Writes to a FILE*, at its current position.
+class TiXmlFileOutputSink : public TiXmlOutputSink
+{
+public:
+	TiXmlFileOutputSink( FILE* _file ) : file( _file ) {}
+
+	virtual bool Write( const char* data, int size );
+
+private:
+	TiXmlFileOutputSink( const TiXmlFileOutputSink& );	// not implemented.
+	void operator=( const TiXmlFileOutputSink& );		// not allowed.
+
+	FILE* file;
+};
+
+
+/// Writes to a file descriptor, at its current position. The descriptor is not closed.
+class TiXmlFdOutputSink : public TiXmlOutputSink
+{
+public:
+	TiXmlFdOutputSink( int _fd ) : fd( _fd ) {}
+
+	virtual bool Write( const char* data, int size );
+
+private:
+	TiXmlFdOutputSink( const TiXmlFdOutputSink& );	// not implemented.
+	void operator=( const TiXmlFdOutputSink& );		// not allowed.
+
+	int fd;
+};
+
+
+/*	[internal use] The output of TiXmlPrinter, TiXmlWriter and
+	TiXmlCanonicalPrinter collects here and, if there is a sink, is passed
+	on to it a chunk at a time.
+*/
+class TiXmlOutputBuffer
+{
+public:
+	TiXmlOutputBuffer() : sink( 0 ), chunkSize( 0 ), sinkError( false ), sent( 0 ) {}
+
+	void SetSink( TiXmlOutputSink* sink, size_t chunkSize );
+	bool Flush();
+
+	void Write( const char* str, size_t length ) {
+		buffer.append( str, length );
+		Wrote();
+	}
+	void Write( const char* str )					{ Write( str, strlen( str ) ); }
+	void Write( const TIXML_STRING& str )			{ Write( str.c_str(), str.length() ); }
+	void WriteEncoded( const char* str, size_t length ) {
+		TiXmlBase::EncodeString( str, length, &buffer );
+		Wrote();
+	}
+	void WriteEncoded( const TIXML_STRING& str )	{ WriteEncoded( str.c_str(), str.length() ); }
+	// Call after appending to the buffer directly; sends a chunk on if one is due.
+	void Wrote() {
+		if ( sink && buffer.length() >= chunkSize )
+			Flush();
+	}
+
+	TiXmlOutputSink* sink;
+	size_t chunkSize;
+	bool sinkError;		// a write to the sink failed
+	size_t sent;		// the number of bytes passed to the sink so far
+	TIXML_STRING buffer;
+};
+
+
 /** Print to memory functionality. The TiXmlPrinter is useful when you need to:
 
 	-# Print to memory (especially in non-STL mode)
@@ -1729,9 +2539,12 @@ private:
 */
 class TiXmlPrinter : public TiXmlVisitor
 {
+	friend class TiXmlParallelPrint;
+	friend class TiXmlTemplatePrinter;
+
 public:
-	TiXmlPrinter() : depth( 0 ), simpleTextPrint( false ),
-					 buffer(), indent( "    " ), lineBreak( "\n" ) {}
+	TiXmlPrinter() : depth( 0 ), simpleTextPrint( false ), cacheSize( 0 ), fromCache( false ),
+					 indent( "    " ), lineBreak( "\n" ) {}
 
 	virtual bool VisitEnter( const TiXmlDocument& doc );
 	virtual bool VisitExit( const TiXmlDocument& doc );
@@ -1765,32 +2578,682 @@ public:
 													  lineBreak = "";
 													}	
 	/// Return the result.
-	const char* CStr()								{ return buffer.c_str(); }
+	const char* CStr()								{ return output.buffer.c_str(); }
 	/// Return the length of the result string.
-	size_t Size()									{ return buffer.size(); }
+	size_t Size()									{ return output.buffer.size(); }
 
 	#ifdef TIXML_USE_STL
 	/// Return the result.
-	const std::string& Str()						{ return buffer; }
+	const std::string& Str()						{ return output.buffer; }
 	#endif
 
+	/** Empty the result, keeping the memory it used, so the printer
+		can be used again for another document without reallocating.
+		The indent and line break settings are kept too.
+	*/
+	void Reset();
+
+	/** Print a node (usually a document) on to the end of the result.
+		The same as node.Accept( &printer ), except that when printing to
+		a sink, the rest of the output is sent on as well.
+	*/
+	void Print( const TiXmlNode& node );
+
+	/** Send the output to 'sink', in chunks of about 'chunkSize' bytes, as
+		it is printed, rather than keeping all of it. The memory used is
+		then about a chunk, or the longest single text or attribute value
+		if that is bigger. CStr() and Size() only cover the output that
+		hasn't been sent yet.
+
+		The last chunk is sent at the end of a document; after printing
+		anything else, call Flush(). Pass null to go back to keeping the
+		output in memory.
+	*/
+	void SetSink( TiXmlOutputSink* sink, size_t chunkSize = 64 * 1024 )	{ output.SetSink( sink, chunkSize ); }
+	/** Send any output waiting in the buffer to the sink. Returns false
+		if any write to the sink has failed since SetSink().
+	*/
+	bool Flush()									{ return output.Flush(); }
+
+	/** Keep the output of each element of at least 'minSize' bytes with
+		the element, and print it again from there the next time, as long
+		as nothing in it has changed since and it is printed at the same
+		depth and with the same indent and line break. Changes made through
+		the TinyXML API are tracked; anything else (such as a const_cast)
+		isn't. Worth it when a large document is printed over and over with
+		a few edits in between. 0, the default, turns caching off.
+
+		A caching printer writes to the nodes it prints, so while it is
+		printing a document nothing else may read that document. When
+		printing to a sink, an element is only kept if all of its output is
+		still waiting in the buffer when it ends: the ones bigger than a
+		chunk aren't, but the elements in them are. (SaveFile() doesn't use
+		a TiXmlPrinter; to save a file from the cache, print to a
+		TiXmlFileOutputSink.) The cache isn't used with
+		TiXmlThreadPool::Print(), and isn't built in at all with
+		TIXML_SLIM_NODES.
+	*/
+	void SetCaching( size_t minSize )				{ cacheSize = minSize; }
+
 private:
+	void Write( const char* str, size_t length )	{ output.Write( str, length ); }
+	void Write( const char* str )					{ output.Write( str ); }
+	void Write( const TIXML_STRING& str )			{ output.Write( str ); }
+	void WriteEncoded( const TIXML_STRING& str )	{ output.WriteEncoded( str ); }
+	// Virtual so that TiXmlTemplate can find its placeholders in the values.
+	virtual void WriteText( const TiXmlText& text ) {
+		if ( text.Raw() || text.plain )
+			Write( text.ValueTStr() );
+		else
+			WriteEncoded( text.ValueTStr() );
+	}
+	virtual void WriteAttribute( const TiXmlAttribute& attribute ) {
+		attribute.Print( 0, 0, &output.buffer );
+		output.Wrote();
+	}
+
 	void DoIndent()	{
 		for( int i=0; i<depth; ++i )
-			buffer += indent;
+			Write( indent );
 	}
 	void DoLineBreak() {
-		buffer += lineBreak;
+		Write( lineBreak );
 	}
+	bool Caching() const							{ return cacheSize > 0; }
 
 	int depth;
 	bool simpleTextPrint;
-	TIXML_STRING buffer;
+	size_t cacheSize;
+	bool fromCache;		// the element being left was printed from its cache
+	TIXML_STRING marks;	// where each open element's output starts, counting what was sent, as size_t's
+	TiXmlOutputBuffer output;
 	TIXML_STRING indent;
 	TIXML_STRING lineBreak;
 };
 
 
+/**	Writes XML as it goes, without building a document first, for output
+	too big (or too simple) to be worth the nodes.
+	@verbatim
+	TiXmlWriter writer;
+	writer.PushDeclaration( "1.0", "UTF-8", "" );
+	writer.OpenElement( "report" );
+	writer.OpenElement( "row" );
+	writer.PushAttribute( "id", 1 );
+	writer.PushText( "fish & chips" );
+	writer.CloseElement();
+	writer.CloseElement();
+	fprintf( stdout, "%s", writer.CStr() );
+	@endverbatim
+
+	Text and attribute values are escaped as EncodeString() does. The
+	layout is the same as TiXmlPrinter's, and can be changed the same way;
+	an element that holds text and also other nodes is laid out a little
+	differently, since the writer can't look ahead. Like the printer, the
+	output can be kept in memory or sent on to a TiXmlOutputSink.
+*/
+class TiXmlWriter
+{
+public:
+	TiXmlWriter() : depth( 0 ), tagOpen( false ), textInline( false ),
+					indent( "    " ), lineBreak( "\n" ) {}
+
+	/// Write an XML declaration. Empty values are left out.
+	void PushDeclaration( const char* version, const char* encoding, const char* standalone );
+	/// Start an element. Its attributes have to be pushed next, before anything else.
+	void OpenElement( const char* name );
+	/// Add an attribute to the element just opened. A null value is written as empty.
+	void PushAttribute( const char* name, const char* value );
+	/// Add an attribute with an integer value.
+	void PushAttribute( const char* name, int value );
+	/// Add an attribute with a double value.
+	void PushAttribute( const char* name, double value );
+	/// Write text, or a CDATA section if 'cdata' is true. Null text is written as empty.
+	void PushText( const char* text, bool cdata = false );
+	/// Write a comment. A null comment is written as empty.
+	void PushComment( const char* comment );
+	/// End the element opened last.
+	void CloseElement();
+
+	#ifdef TIXML_USE_STL
+	void OpenElement( const std::string& name )							{ OpenElement( name.c_str() ); }
+	void PushAttribute( const std::string& name, const std::string& value )	{ PushAttribute( name.c_str(), value.c_str() ); }
+	void PushText( const std::string& text, bool cdata = false )		{ PushText( text.c_str(), cdata ); }
+	#endif
+
+	/// The number of elements open.
+	int Depth() const												{ return depth; }
+
+	/// Set the indent, as TiXmlPrinter::SetIndent().
+	void SetIndent( const char* _indent )							{ indent = _indent ? _indent : "" ; }
+	/// Set the line break, as TiXmlPrinter::SetLineBreak().
+	void SetLineBreak( const char* _lineBreak )						{ lineBreak = _lineBreak ? _lineBreak : ""; }
+	/// No indents or line breaks, as TiXmlPrinter::SetStreamPrinting().
+	void SetStreamPrinting()										{ indent = ""; lineBreak = ""; }
+
+	/** Send the output to a sink, as TiXmlPrinter::SetSink(). The last
+		chunk is sent when the outermost element is closed, or by Flush().
+	*/
+	void SetSink( TiXmlOutputSink* sink, size_t chunkSize = 64 * 1024 )	{ output.SetSink( sink, chunkSize ); }
+	/// Send any waiting output to the sink. Returns false if any write to it has failed.
+	bool Flush()													{ return output.Flush(); }
+
+	/// Return the result (or what is waiting to go to the sink.)
+	const char* CStr()												{ return output.buffer.c_str(); }
+	/// Return the length of the result string.
+	size_t Size()													{ return output.buffer.size(); }
+	#ifdef TIXML_USE_STL
+	/// Return the result.
+	const std::string& Str()										{ return output.buffer; }
+	#endif
+
+	/// Empty the result, keeping its memory, and close any open elements without writing them.
+	void Reset();
+
+private:
+	TiXmlWriter( const TiXmlWriter& );		// not implemented.
+	void operator=( const TiXmlWriter& );	// not allowed.
+
+	void Write( const char* str, size_t length )					{ output.Write( str, length ); }
+	void Write( const char* str )									{ output.Write( str ); }
+	void WriteEncoded( const char* str )							{ output.WriteEncoded( str, strlen( str ) ); }
+	void BeginLine();
+	void DoIndent() {
+		for( int i=0; i<depth; ++i )
+			Write( indent.c_str(), indent.length() );
+	}
+	void DoLineBreak()												{ Write( lineBreak.c_str(), lineBreak.length() ); }
+
+	int depth;
+	bool tagOpen;		// the last start tag is waiting for its '>'
+	bool textInline;	// text was written straight after the last start tag
+	TIXML_STRING names;	// the names of the open elements, each ended by a null
+	TiXmlOutputBuffer output;
+	TIXML_STRING indent;
+	TIXML_STRING lineBreak;
+};
+
+
+/**	A document printed once and then turned out over and over with new
+	values in it, for many messages of the same shape. It is much faster
+	than building and printing a document each time. The values go where
+	the document has placeholders, written ${name}, in its text and
+	attribute values:
+	@verbatim
+	TiXmlDocument doc;
+	doc.Parse( "<order id='${id}'><item>${item}</item></order>" );
+	TiXmlTemplate order;
+	order.Compile( doc );
+
+	const char* values[ 2 ];
+	values[ order.Slot( "id" ) ] = "17";
+	values[ order.Slot( "item" ) ] = "fish & chips";
+	TIXML_STRING out;
+	order.Render( values, &out );
+	@endverbatim
+
+	Compile() prints everything but the values, the way TiXmlPrinter
+	would; Render() only copies that out, encoding the values in between.
+	A placeholder anywhere else, such as in a comment or CDATA, is just
+	text. A compiled template isn't changed by Render(), so any number of
+	threads can render it at once.
+*/
+class TiXmlTemplate
+{
+	friend class TiXmlTemplatePrinter;
+
+public:
+	TiXmlTemplate() : pieces( 0 ), pieceCount( 0 ), pieceCapacity( 0 ), slots( 0 ) {}
+	~TiXmlTemplate()								{ delete [] pieces; }
+
+	/** Print 'node', usually a document, with the given indent and line
+		break, and find its placeholders. Anything compiled before is
+		replaced.
+	*/
+	void Compile( const TiXmlNode& node, const char* indent = "    ", const char* lineBreak = "\n" );
+
+	/// The number of different placeholder names. A name used twice is one slot.
+	int Slots() const								{ return slots; }
+	/// The slot of the placeholder 'name', or -1 if there isn't one.
+	int Slot( const char* name ) const;
+	/// The name of a slot, or null if it is out of range.
+	const char* SlotName( int slot ) const;
+
+	/** Append the output to 'out', with values[ slot ] encoded in place of
+		each placeholder. 'values' must have Slots() entries; a null entry
+		is the same as an empty value.
+	*/
+	void Render( const char* const* values, TIXML_STRING* out ) const;
+
+private:
+	TiXmlTemplate( const TiXmlTemplate& );		// not implemented.
+	void operator=( const TiXmlTemplate& );		// not allowed.
+
+	struct Piece
+	{
+		size_t end;		// where the static output before the placeholder ends
+		int slot;
+	};
+	int FindSlot( const char* name, size_t length ) const;
+	void AddPlaceholder( size_t end, const char* name, size_t length );
+
+	TIXML_STRING text;		// the static output, without the placeholders
+	TIXML_STRING names;		// the slot names, each ended by a null
+	Piece* pieces;
+	int pieceCount;
+	int pieceCapacity;
+	int slots;
+};
+
+
+/**	Prints a document, or an element and what is in it, as Canonical XML
+	(http://www.w3.org/TR/xml-c14n), the form used for comparing, hashing
+	and signing XML. Give it a sink that feeds a hash to hash a document
+	in one pass, without the canonical form ever being held in memory:
+	@verbatim
+	MyHashSink hash;
+	TiXmlCanonicalPrinter canonical;
+	canonical.SetSink( &hash );
+	doc.Accept( &canonical );
+	@endverbatim
+
+	The XML declaration and DOCTYPE are left out, empty elements are
+	written as a start and end tag, attributes are sorted (namespace
+	declarations first) and always double quoted, CDATA sections become
+	text, and characters are escaped the canonical way. Namespace
+	declarations that repeat one already in effect are left out; an
+	element printed without its parents gets the declarations and xml:
+	attributes it inherits from them. Comments are left out unless
+	SetComments() is on.
+
+	The canonical form keeps all white space, but TinyXML drops text that
+	is only white space, and condenses the rest unless condensing is
+	turned off. So the output matches other implementations only for
+	documents without white space between their tags, such as those
+	written with stream printing. TinyXML doesn't normalize white space in
+	attribute values as it reads them either, so a line break in one is
+	printed as &#xA;.
+*/
+class TiXmlCanonicalPrinter : public TiXmlVisitor
+{
+public:
+	TiXmlCanonicalPrinter() : depth( 0 ), afterRoot( false ), comments( false ),
+							  attributes( 0 ), attributeCapacity( 0 ) {}
+	virtual ~TiXmlCanonicalPrinter();
+
+	virtual bool VisitEnter( const TiXmlDocument& doc );
+	virtual bool VisitExit( const TiXmlDocument& doc );
+
+	virtual bool VisitEnter( const TiXmlElement& element, const TiXmlAttribute* firstAttribute );
+	virtual bool VisitExit( const TiXmlElement& element );
+
+	virtual bool Visit( const TiXmlDeclaration& declaration );
+	virtual bool Visit( const TiXmlText& text );
+	virtual bool Visit( const TiXmlComment& comment );
+	virtual bool Visit( const TiXmlUnknown& unknown );
+
+	/// Keep the comments ("with comments" canonical XML). Off by default.
+	void SetComments( bool keep )					{ comments = keep; }
+
+	/// Return the result.
+	const char* CStr()								{ return output.buffer.c_str(); }
+	/// Return the length of the result string.
+	size_t Size()									{ return output.buffer.size(); }
+	#ifdef TIXML_USE_STL
+	/// Return the result.
+	const std::string& Str()						{ return output.buffer; }
+	#endif
+
+	/// Empty the result, keeping its memory, to print something else.
+	void Reset();
+
+	/** Send the output to 'sink', in chunks of about 'chunkSize' bytes, as
+		TiXmlPrinter::SetSink() does.
+	*/
+	void SetSink( TiXmlOutputSink* sink, size_t chunkSize = 64 * 1024 )	{ output.SetSink( sink, chunkSize ); }
+	/** Send any output waiting in the buffer to the sink. Returns false
+		if any write to the sink has failed since SetSink().
+	*/
+	bool Flush()									{ return output.Flush(); }
+
+private:
+	TiXmlCanonicalPrinter( const TiXmlCanonicalPrinter& );	// not implemented.
+	void operator=( const TiXmlCanonicalPrinter& );			// not allowed.
+
+	void Write( const char* str, size_t length )	{ output.Write( str, length ); }
+	void Write( const TIXML_STRING& str )			{ output.Write( str ); }
+	void WriteEscaped( const TIXML_STRING& str, bool attribute );
+	void WriteMarkup( const char* start, const TIXML_STRING& str, const char* end );
+
+	int CollectAttributes( const TiXmlElement& element );
+	int AddAttribute( int count, const TiXmlElement& element, const TiXmlAttribute* attribute );
+	const char* NamespaceOf( const TiXmlElement& element, const char* prefix, size_t length );
+	static bool Redundant( const TiXmlElement& element, const TiXmlAttribute* declaration );
+
+	int depth;
+	bool afterRoot;		// the document element has been printed
+	bool comments;
+	TiXmlOutputBuffer output;
+	TIXML_STRING lookup;	// room to make "xmlns:prefix" in
+	TiXmlCanonicalAttribute* attributes;	// an element's attributes, to sort
+	int attributeCapacity;
+};
+
+
+#ifdef TIXML_USE_THREADS
+
+/** A unit of work for a TiXmlThreadPool. The task must stay alive until
+	Run() has been called; it is fine for Run() to delete the task as the
+	last thing it does.
+*/
+class TiXmlTask
+{
+public:
+	virtual ~TiXmlTask()	{}
+	/// Do the work. Called once, on one of the pool's threads.
+	virtual void Run() = 0;
+};
+
+
+/** Makes the visitors for TiXmlThreadPool::Accept(), and combines
+	their results once the walk is over.
+*/
+class TiXmlVisitorFactory
+{
+public:
+	virtual ~TiXmlVisitorFactory()	{}
+	/// Make the visitor for one worker thread.
+	virtual TiXmlVisitor* Create() = 0;
+	/** Fold the results of a visitor made by Create() in to the overall
+		result, and delete it.
+	*/
+	virtual void Reduce( TiXmlVisitor* visitor ) = 0;
+};
+
+
+/** A fixed set of worker threads running TiXmlTasks in the order they
+	are queued. Only available if TIXML_USE_THREADS is defined, which
+	needs a compiler and library with C++11 threads.
+*/
+class TiXmlThreadPool
+{
+public:
+	/// Start 'threads' worker threads, or one per processor if 0.
+	TiXmlThreadPool( int threads = 0 );
+	/// Waits for all the queued tasks to run, then stops the threads.
+	~TiXmlThreadPool();
+
+	/// Queue a task to run on one of the worker threads.
+	void Run( TiXmlTask* task );
+	/** Block until every queued task has run. Don't call this from a task
+		running on the same pool, it will never return.
+	*/
+	void Wait();
+	/// The number of worker threads.
+	int ThreadCount() const;
+
+	/** Walk the tree under 'node' with visitors spread over the worker
+		threads, and block until the walk is done.
+
+		Every worker gets a visitor of its own from the factory, and works
+		on whole subtrees. A worker that is about to enter an element,
+		while another worker has run out of things to do, hands the
+		element's children out as separate subtrees instead of walking
+		them itself; idle workers steal those subtrees from the busy ones.
+		So each node is visited exactly once, but a visitor sees a set of
+		disconnected subtrees, in no particular order: an element's
+		VisitExit() may come before its children are visited elsewhere.
+		This suits passes that add things up, such as counting or
+		gathering statistics, which Reduce() then combines.
+
+		Returning false from VisitEnter() skips the children of that
+		element, as with Accept(). The other return values are ignored,
+		since the siblings may already be in progress on other threads.
+
+		Create() and Reduce() are called on the calling thread, Reduce()
+		once per visitor after the walk is finished. The tree must not
+		change during the walk. Don't call this from a task running on
+		the same pool; it shares the workers with any other queued tasks.
+	*/
+	void Accept( const TiXmlNode* node, TiXmlVisitorFactory* factory );
+
+	/** Print 'node' with 'printer', just as node.Accept( printer ) would,
+		but with the work spread over the worker threads: the tree is cut
+		in to runs of siblings of about the same size, each run is printed
+		in to a buffer of its own, at its own depth, and the buffers are
+		put together in order at the end (or sent to the printer's sink
+		one after another.) Blocks until it is done.
+
+		Worth it for documents of many megabytes. It needs memory for the
+		whole output, even when the printer has a sink. The same rules as
+		Accept() apply: the tree must not change, and don't call it from a
+		task on the same pool.
+	*/
+	void Print( const TiXmlNode& node, TiXmlPrinter* printer );
+
+private:
+	TiXmlThreadPool( const TiXmlThreadPool& );		// not implemented.
+	void operator=( const TiXmlThreadPool& );		// not allowed.
+
+	struct Impl;
+	Impl* impl;
+};
+
+
+class TiXmlAsyncIOImpl;
+
+/** Receives the results of TiXmlAsyncIO requests. The methods are
+	called on a worker thread, so they must be thread safe with respect
+	to the rest of the program.
+*/
+class TiXmlAsyncHandler
+{
+public:
+	virtual ~TiXmlAsyncHandler()	{}
+
+	/** Called when a load has finished. On failure the document holds the
+		error, just as if TiXmlDocument::LoadFile() had been called.
+	*/
+	virtual void LoadComplete( TiXmlDocument* /*doc*/, bool /*success*/ )			{}
+	/// Called when a save has finished.
+	virtual void SaveComplete( const TiXmlDocument* /*doc*/, bool /*success*/ )	{}
+};
+
+
+/** Loads and saves documents without blocking the calling thread.
+
+	On Linux the file reads and writes are submitted through io_uring,
+	so the I/O for many documents is in flight at once; parsing and
+	printing happen on a TiXmlThreadPool. Where io_uring isn't available,
+	the pool does the I/O as well.
+
+	@verbatim
+	class MyHandler : public TiXmlAsyncHandler
+	{
+		virtual void LoadComplete( TiXmlDocument* doc, bool success ) { ... }
+	};
+
+	TiXmlAsyncIO io;
+	MyHandler handler;
+	io.LoadFile( &doc, "myfile.xml", &handler );
+	@endverbatim
+
+	A document must not be used by anything else from the time it is
+	passed in until its handler has been called (or Wait() returns.)
+	Only available if TIXML_USE_THREADS is defined.
+*/
+class TiXmlAsyncIO
+{
+public:
+	/** Do the parsing and printing on the given pool, or on a pool of
+		its own if null. A pool that is passed in must outlive this object.
+	*/
+	TiXmlAsyncIO( TiXmlThreadPool* pool = 0 );
+	/// Waits for all the outstanding requests to complete.
+	~TiXmlAsyncIO();
+
+	/// Start loading 'filename' in to 'doc'. The handler may be null.
+	void LoadFile( TiXmlDocument* doc, const char* filename, TiXmlAsyncHandler* handler, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING );
+	/** Start saving 'doc' to 'filename'. The handler may be null. The
+		file gets the same bytes doc->SaveFile( filename ) writes, through
+		any Print() overrides, with or without io_uring.
+	*/
+	void SaveFile( const TiXmlDocument* doc, const char* filename, TiXmlAsyncHandler* handler );
+
+	#ifdef TIXML_USE_STL
+	void LoadFile( TiXmlDocument* doc, const std::string& filename, TiXmlAsyncHandler* handler, TiXmlEncoding encoding = TIXML_DEFAULT_ENCODING )	///< STL std::string version.
+	{
+		LoadFile( doc, filename.c_str(), handler, encoding );
+	}
+	void SaveFile( const TiXmlDocument* doc, const std::string& filename, TiXmlAsyncHandler* handler )	///< STL std::string version.
+	{
+		SaveFile( doc, filename.c_str(), handler );
+	}
+	#endif
+
+	/// Block until every request made so far has completed and its handler has returned.
+	void Wait();
+	/// True if the I/O is going through io_uring, false if it falls back to the thread pool.
+	bool UsesIoUring() const;
+
+private:
+	TiXmlAsyncIO( const TiXmlAsyncIO& );		// not implemented.
+	void operator=( const TiXmlAsyncIO& );		// not allowed.
+
+	TiXmlAsyncIOImpl* impl;
+};
+
+/** Deletes nodes on a thread of its own. Tearing down a large document
+	touches every node in it, which can take a while; handing the document to
+	a TiXmlReclaimer takes that time off the thread that is done with it.
+
+	@verbatim
+	TiXmlReclaimer reclaimer;
+	...
+	reclaimer.Reclaim( doc );		// instead of: delete doc;
+	reclaimer.Reclaim( element->DetachChild( bigSubtree ) );
+	@endverbatim
+
+	Only available if TIXML_USE_THREADS is defined.
+*/
+class TiXmlReclaimer
+{
+public:
+	TiXmlReclaimer();
+	/// Deletes everything still queued, then stops the thread.
+	~TiXmlReclaimer();
+
+	/** Queue a node (and all its children) to be deleted. The node must not
+		have a parent, and must not be used again by the caller.
+	*/
+	void Reclaim( TiXmlNode* node );
+	/// Block until everything queued so far has been deleted.
+	void Wait();
+
+private:
+	TiXmlReclaimer( const TiXmlReclaimer& );		// not implemented.
+	void operator=( const TiXmlReclaimer& );		// not allowed.
+
+	struct Impl;
+	Impl* impl;
+};
+
+
+class TiXmlDocumentVersion;
+class TiXmlDocumentHolderImpl;
+
+/** A reference to one published version of a document in a
+	TiXmlDocumentHolder. The version stays alive, unchanged, for as long as
+	any snapshot of it exists, however many newer versions are published
+	meanwhile. Snapshots can be copied and passed between threads; copying
+	one is an atomic increment.
+
+	Only available if TIXML_USE_THREADS is defined.
+*/
+class TiXmlSnapshot
+{
+public:
+	/// An empty snapshot, of no document.
+	TiXmlSnapshot() : version( 0 )	{}
+	TiXmlSnapshot( const TiXmlSnapshot& copy );
+	TiXmlSnapshot& operator=( const TiXmlSnapshot& copy );
+	~TiXmlSnapshot();
+
+	/// The document, or null for an empty snapshot. It must not be changed.
+	const TiXmlDocument* Document() const;
+	const TiXmlDocument* operator->() const		{ return Document(); }	///< The document.
+	/// The number of the version: 1 for the first one published, and so on. 0 if empty.
+	unsigned long Generation() const;
+
+private:
+	friend class TiXmlDocumentHolder;
+	explicit TiXmlSnapshot( TiXmlDocumentVersion* _version ) : version( _version )	{}
+
+	TiXmlDocumentVersion* version;
+};
+
+
+/** Holds the current version of a document that is read by many threads
+	and replaced now and then, such as configuration that is reloaded.
+
+	Readers call Snapshot() to get the current version. That takes no lock
+	and never waits for a writer. A writer builds the next version (from
+	scratch, or from CopyCurrent()) while readers carry on with the old one,
+	then Publish()es it. New snapshots get the new version; the old one is
+	deleted when its last snapshot goes away, by a TiXmlReclaimer if one was
+	given.
+
+	@verbatim
+	TiXmlDocumentHolder config;
+
+	// Reader threads:
+	TiXmlSnapshot snapshot = config.Snapshot();
+	const TiXmlElement* server = snapshot->FirstChildElement( "server" );
+
+	// Writer thread:
+	TiXmlDocument* next = new TiXmlDocument();
+	if ( next->LoadFile( "config.xml" ) )
+		config.Publish( next );
+	@endverbatim
+
+	Only available if TIXML_USE_THREADS is defined.
+*/
+class TiXmlDocumentHolder
+{
+public:
+	/** Old versions are deleted by the reclaimer, if given, or else by the
+		thread releasing the last snapshot. The reclaimer must outlive every
+		snapshot.
+	*/
+	TiXmlDocumentHolder( TiXmlReclaimer* reclaimer = 0 );
+	/// Lets go of the current version. Snapshots that are still held stay valid.
+	~TiXmlDocumentHolder();
+
+	/// The current version. Empty if nothing has been published.
+	TiXmlSnapshot Snapshot() const;
+
+	/** Make 'doc' the current version. The holder takes ownership of it,
+		and it must not be changed after this. Writers may call this from
+		several threads; they are serialized.
+	*/
+	void Publish( TiXmlDocument* doc );
+
+	/** A new copy of the current version (or an empty document if there is
+		none) for a writer to change and Publish(). Owned by the caller
+		until then.
+	*/
+	TiXmlDocument* CopyCurrent() const;
+
+private:
+	TiXmlDocumentHolder( const TiXmlDocumentHolder& );	// not implemented.
+	void operator=( const TiXmlDocumentHolder& );		// not allowed.
+
+	TiXmlDocumentHolderImpl* impl;
+};
+
+#endif	// TIXML_USE_THREADS
+
+
 #ifdef _MSC_VER
 #pragma warning( pop )
 #endif
@@ -176,23 +176,107 @@ class TiXmlParsingData
 
 	const TiXmlCursor& Cursor() const	{ return cursor; }
 
+	// The document being parsed, and its options.
+	TiXmlDocument* Document() const		{ return document; }
+	bool CondenseWhiteSpace() const		{ return condense; }
+	bool KeepComments() const			{ return keepComments; }
+
+	// The elements being read are nested inside 'depth' others. Enter() and
+	// Leave() go in and out of the content of an element.
+	bool TooDeep() const	{ return maxDepth > 0 && depth >= maxDepth; }
+	void Enter()			{ ++depth; }
+	void Leave()			{ --depth; }
+
   private:
 	// Only used by the document!
-	TiXmlParsingData( const char* start, int _tabsize, int row, int col )
+	TiXmlParsingData( const char* start, TiXmlDocument* _document, const TiXmlParseOptions& options, int row, int col )
 	{
 		assert( start );
 		stamp = start;
-		tabsize = _tabsize;
+		tabsize = options.tabSize;
 		cursor.row = row;
 		cursor.col = col;
+		document = _document;
+		if ( options.whiteSpace == TIXML_WHITESPACE_DEFAULT )
+			condense = TiXmlBase::IsWhiteSpaceCondensed();
+		else
+			condense = options.whiteSpace == TIXML_WHITESPACE_CONDENSE;
+		keepComments = options.keepComments;
+		depth = 0;
+		maxDepth = options.maxDepth;
 	}
 
 	TiXmlCursor		cursor;
 	const char*		stamp;
 	int				tabsize;
+	TiXmlDocument*	document;
+	bool			condense;
+	bool			keepComments;
+	int				depth;
+	int				maxDepth;
 };
 
 
+// The document a node is being parsed in to. The parsing data knows it, which
+// saves walking up the parents; a node parsed on its own has to look.
+static TiXmlDocument* TiXmlParseDocument( TiXmlNode* node, TiXmlParsingData* data )
+{
+	return data ? data->Document() : node->GetDocument();
+}
+
+
+// Whether text is having its white space condensed.
+static bool TiXmlCondenseWhiteSpace( TiXmlParsingData* data )
+{
+	return data ? data->CondenseWhiteSpace() : TiXmlBase::IsWhiteSpaceCondensed();
+}
+
+
+// A new, empty node for the parser. Reuses one kept by TiXmlDocument::Reset()
+// if there is one.
+static TiXmlNode* TiXmlNewNode( TiXmlDocument* document, TiXmlNode::NodeType type )
+{
+	TiXmlNode* node = document ? document->CachedNode( type ) : 0;
+	if ( node )
+		return node;
+
+	switch( type )
+	{
+		case TiXmlNode::TINYXML_ELEMENT:		node = new TiXmlElement( "" );		break;
+		case TiXmlNode::TINYXML_COMMENT:		node = new TiXmlComment();			break;
+		case TiXmlNode::TINYXML_TEXT:			node = new TiXmlText( "" );			break;
+		case TiXmlNode::TINYXML_DECLARATION:	node = new TiXmlDeclaration();		break;
+		default:								node = new TiXmlUnknown();			break;
+	}
+	node->SetRecyclable();
+	return node;
+}
+
+
+// Give back a node the parser has no use for.
+static void TiXmlDeleteNode( TiXmlDocument* document, TiXmlNode* node )
+{
+	if ( document )
+		document->Recycle( node );
+	else
+		delete node;
+}
+
+
+void TiXmlBase::StampLocation( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
+{
+	#ifndef TIXML_SLIM_NODES
+	if ( data )
+	{
+		data->Stamp( p, encoding );
+		location = data->Cursor();
+	}
+	#else
+	(void) p; (void) data; (void) encoding;
+	#endif
+}
+
+
 void TiXmlParsingData::Stamp( const char* now, TiXmlEncoding encoding )
 {
 	assert( now );
@@ -362,36 +446,82 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 }
 
 #ifdef TIXML_USE_STL
+// The stream input functions talk to the streambuf directly. Going through
+// istream::peek() and istream::get() builds a sentry object for every single
+// character, which made operator>> an order of magnitude slower than LoadFile.
+// The streambuf already reads its source in blocks; these helpers just keep
+// us from paying for the istream layer on top of it.
+static inline int TiXmlStreamPeek( std::istream* in )
+{
+	int c = in->rdbuf()->sgetc();
+	if ( c == std::char_traits< char >::eof() )
+		in->setstate( std::ios::eofbit );
+	return c;
+}
+
+
+static inline int TiXmlStreamGet( std::istream* in )
+{
+	int c = in->rdbuf()->sbumpc();
+	if ( c == std::char_traits< char >::eof() )
+		in->setstate( std::ios::eofbit | std::ios::failbit );
+	return c;
+}
+
+
+// Appends characters to 'tag' up to (but not including) 'stop', a null, or
+// the end of the stream, whichever comes first. The characters are collected
+// in a local block so the string is appended to in bulk rather than a character
+// at a time. Returns the character that ended the run, which is left unread.
+static int TiXmlStreamRun( std::istream* in, int stop, TIXML_STRING* tag )
+{
+	std::streambuf* buf = in->rdbuf();
+	char block[ 256 ];
+	int n = 0;
+
+	int c = buf->sgetc();
+	while ( c != stop && c > 0 )
+	{
+		block[ n++ ] = (char) c;
+		if ( n == (int) sizeof( block ) )
+		{
+			tag->append( block, n );
+			n = 0;
+		}
+		c = buf->snextc();
+	}
+	if ( n )
+		tag->append( block, n );
+
+	if ( c == std::char_traits< char >::eof() )
+		in->setstate( std::ios::eofbit );
+	return c;
+}
+
+
 /*static*/ bool TiXmlBase::StreamWhiteSpace( std::istream * in, TIXML_STRING * tag )
 {
 	for( ;; )
 	{
 		if ( !in->good() ) return false;
 
-		int c = in->peek();
+		int c = TiXmlStreamPeek( in );
 		// At this scope, we can't get to a document. So fail silently.
 		if ( !IsWhiteSpace( c ) || c <= 0 )
 			return true;
 
-		*tag += (char) in->get();
+		*tag += (char) TiXmlStreamGet( in );
 	}
 }
 
 /*static*/ bool TiXmlBase::StreamTo( std::istream * in, int character, TIXML_STRING * tag )
 {
 	//assert( character > 0 && character < 128 );	// else it won't work in utf-8
-	while ( in->good() )
-	{
-		int c = in->peek();
-		if ( c == character )
-			return true;
-		if ( c <= 0 )		// Silent failure: can't get document at this scope
-			return false;
+	if ( !in->good() )
+		return false;
 
-		in->get();
-		*tag += (char) c;
-	}
-	return false;
+	// Silent failure on a null or the end of the stream: can't get document at this scope
+	return TiXmlStreamRun( in, character, tag ) == character;
 }
 #endif
 
@@ -400,10 +530,9 @@ const char* TiXmlBase::SkipWhiteSpace( const char* p, TiXmlEncoding encoding )
 //
 const char* TiXmlBase::ReadName( const char* p, TIXML_STRING * name, TiXmlEncoding encoding )
 {
-	// Oddly, not supported on some comilers,
-	//name->clear();
-	// So use this:
-	*name = "";
+	// Empty the name, but keep its buffer (clear() would release it) so
+	// that nodes recycled by TiXmlDocument::Reset() don't allocate.
+	name->resize( 0 );
 	assert( p );
 
 	// Names start with letters or underscores.
@@ -578,9 +707,8 @@ const char* TiXmlBase::ReadText(	const char* p,
 									bool caseInsensitive,
 									TiXmlEncoding encoding )
 {
-    *text = "";
-	if (    !trimWhiteSpace			// certain tags always keep whitespace
-		 || !condenseWhiteSpace )	// if true, whitespace is always kept
+	text->resize( 0 );	// keep the buffer, as in ReadName()
+	if ( !trimWhiteSpace )			// certain tags, and the settings, keep whitespace
 	{
 		// Keep all the white space.
 		while (	   p && *p
@@ -656,15 +784,10 @@ void TiXmlDocument::StreamIn( std::istream * in, TIXML_STRING * tag )
 	while ( in->good() )
 	{
 		int tagIndex = (int) tag->length();
-		while ( in->good() && in->peek() != '>' )
+		if ( TiXmlStreamRun( in, '>', tag ) == 0 )
 		{
-			int c = in->get();
-			if ( c <= 0 )
-			{
-				SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
-				break;
-			}
-			(*tag) += (char) c;
+			TiXmlStreamGet( in );
+			SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
 		}
 
 		if ( in->good() )
@@ -677,7 +800,7 @@ void TiXmlDocument::StreamIn( std::istream * in, TIXML_STRING * tag )
 			if ( node )
 			{
 				node->StreamIn( in, tag );
-				bool isElement = node->ToElement() != 0;
+				bool isElement = node->AsElement() != 0;
 				delete node;
 				node = 0;
 
@@ -717,19 +840,17 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 	// Note that, for a document, this needs to come
 	// before the while space skip, so that parsing
 	// starts from the pointer we are given.
-	location.Clear();
+	int row = 0;
+	int col = 0;
 	if ( prevData )
 	{
-		location.row = prevData->cursor.row;
-		location.col = prevData->cursor.col;
-	}
-	else
-	{
-		location.row = 0;
-		location.col = 0;
+		row = prevData->cursor.row;
+		col = prevData->cursor.col;
 	}
-	TiXmlParsingData data( p, TabSize(), location.row, location.col );
+	TiXmlParsingData data( p, this, parseOptions, row, col );
+	#ifndef TIXML_SLIM_NODES
 	location = data.Cursor();
+	#endif
 
 	if ( encoding == TIXML_ENCODING_UNKNOWN )
 	{
@@ -753,11 +874,17 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 
 	while ( p && *p )
 	{
-		TiXmlNode* node = Identify( p, encoding );
+		TiXmlNode* node = Identify( p, encoding, &data );
 		if ( node )
 		{
 			p = node->Parse( p, &data, encoding );
-			LinkEndChild( node );
+			if ( node->type == TINYXML_COMMENT && !data.KeepComments() ) {
+				TiXmlDeleteNode( this, node );
+				node = 0;
+			}
+			else {
+				LinkEndChild( node );
+			}
 		}
 		else
 		{
@@ -766,9 +893,10 @@ const char* TiXmlDocument::Parse( const char* p, TiXmlParsingData* prevData, TiX
 
 		// Did we get encoding info?
 		if (    encoding == TIXML_ENCODING_UNKNOWN
-			 && node->ToDeclaration() )
+			 && node
+			 && node->AsDeclaration() )
 		{
-			TiXmlDeclaration* dec = node->ToDeclaration();
+			TiXmlDeclaration* dec = node->AsDeclaration();
 			const char* enc = dec->Encoding();
 			assert( enc );
 
@@ -815,9 +943,10 @@ void TiXmlDocument::SetError( int err, const char* pError, TiXmlParsingData* dat
 }
 
 
-TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
+TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding, TiXmlParsingData* data )
 {
 	TiXmlNode* returnNode = 0;
+	TiXmlDocument* document = TiXmlParseDocument( this, data );
 
 	p = SkipWhiteSpace( p, encoding );
 	if( !p || !*p || *p != '<' )
@@ -849,21 +978,21 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Declaration\n" );
 		#endif
-		returnNode = new TiXmlDeclaration();
+		returnNode = TiXmlNewNode( document, TINYXML_DECLARATION );
 	}
 	else if ( StringEqual( p, commentHeader, false, encoding ) )
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Comment\n" );
 		#endif
-		returnNode = new TiXmlComment();
+		returnNode = TiXmlNewNode( document, TINYXML_COMMENT );
 	}
 	else if ( StringEqual( p, cdataHeader, false, encoding ) )
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing CDATA\n" );
 		#endif
-		TiXmlText* text = new TiXmlText( "" );
+		TiXmlText* text = TiXmlNewNode( document, TINYXML_TEXT )->AsText();
 		text->SetCDATA( true );
 		returnNode = text;
 	}
@@ -872,7 +1001,7 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Unknown(1)\n" );
 		#endif
-		returnNode = new TiXmlUnknown();
+		returnNode = TiXmlNewNode( document, TINYXML_UNKNOWN );
 	}
 	else if (    IsAlpha( *(p+1), encoding )
 			  || *(p+1) == '_' )
@@ -880,14 +1009,14 @@ TiXmlNode* TiXmlNode::Identify( const char* p, TiXmlEncoding encoding )
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Element\n" );
 		#endif
-		returnNode = new TiXmlElement( "" );
+		returnNode = TiXmlNewNode( document, TINYXML_ELEMENT );
 	}
 	else
 	{
 		#ifdef DEBUG_PARSER
 			TIXML_LOG( "XML parsing Unknown(2)\n" );
 		#endif
-		returnNode = new TiXmlUnknown();
+		returnNode = TiXmlNewNode( document, TINYXML_UNKNOWN );
 	}
 
 	if ( returnNode )
@@ -904,9 +1033,9 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 {
 	// We're called with some amount of pre-parsing. That is, some of "this"
 	// element is in "tag". Go ahead and stream to the closing ">"
-	while( in->good() )
+	if ( in->good() )
 	{
-		int c = in->get();
+		int c = TiXmlStreamRun( in, '>', tag );
 		if ( c <= 0 )
 		{
 			TiXmlDocument* document = GetDocument();
@@ -914,10 +1043,7 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 				document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
 			return;
 		}
-		(*tag) += (char) c ;
-		
-		if ( c == '>' )
-			break;
+		(*tag) += (char) TiXmlStreamGet( in );
 	}
 
 	if ( tag->length() < 3 ) return;
@@ -943,7 +1069,7 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 			StreamWhiteSpace( in, tag );
 
 			// Do we have text?
-			if ( in->good() && in->peek() != '<' ) 
+			if ( in->good() && TiXmlStreamPeek( in ) != '<' ) 
 			{
 				// Yep, text.
 				TiXmlText text( "" );
@@ -957,7 +1083,7 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 			// We now have either a closing tag...or another node.
 			// We should be at a "<", regardless.
 			if ( !in->good() ) return;
-			assert( in->peek() == '<' );
+			assert( TiXmlStreamPeek( in ) == '<' );
 			int tagIndex = (int) tag->length();
 
 			bool closingTag = false;
@@ -968,7 +1094,7 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 				if ( !in->good() )
 					return;
 
-				int c = in->peek();
+				int c = TiXmlStreamPeek( in );
 				if ( c <= 0 )
 				{
 					TiXmlDocument* document = GetDocument();
@@ -981,7 +1107,7 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 					break;
 
 				*tag += (char) c;
-				in->get();
+				TiXmlStreamGet( in );
 
 				// Early out if we find the CDATA id.
 				if ( c == '[' && tag->size() >= 9 )
@@ -1008,7 +1134,7 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 				if ( !in->good() )
 					return;
 
-				int c = in->get();
+				int c = TiXmlStreamGet( in );
 				if ( c <= 0 )
 				{
 					TiXmlDocument* document = GetDocument();
@@ -1043,7 +1169,7 @@ void TiXmlElement::StreamIn (std::istream * in, TIXML_STRING * tag)
 const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
 	p = SkipWhiteSpace( p, encoding );
-	TiXmlDocument* document = GetDocument();
+	TiXmlDocument* document = TiXmlParseDocument( this, data );
 
 	if ( !p || !*p )
 	{
@@ -1051,11 +1177,7 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 		return 0;
 	}
 
-	if ( data )
-	{
-		data->Stamp( p, encoding );
-		location = data->Cursor();
-	}
+	StampLocation( p, data, encoding );
 
 	if ( *p != '<' )
 	{
@@ -1063,6 +1185,12 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 		return 0;
 	}
 
+	if ( data && data->TooDeep() )
+	{
+		if ( document ) document->SetError( TIXML_ERROR_NESTING_TOO_DEEP, p, data, encoding );
+		return 0;
+	}
+
 	p = SkipWhiteSpace( p+1, encoding );
 
 	// Read the name.
@@ -1075,9 +1203,6 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 		return 0;
 	}
 
-    TIXML_STRING endTag ("</");
-	endTag += value;
-
 	// Check for and read attributes. Also look for an empty
 	// tag or an end tag.
 	while ( p && *p )
@@ -1106,7 +1231,11 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 			// Read the value -- which can include other
 			// elements -- read the end tag, and return.
 			++p;
+			if ( data )
+				data->Enter();
 			p = ReadValue( p, data, encoding );		// Note this is an Element method, and will set the error if one happens.
+			if ( data )
+				data->Leave();
 			if ( !p || !*p ) {
 				// We were looking for the end tag, but found nothing.
 				// Fix for [ 1663758 ] Failure to report error on bad XML
@@ -1119,9 +1248,9 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 			// </foo > and
 			// </foo> 
 			// are both valid end tags.
-			if ( StringEqual( p, endTag.c_str(), false, encoding ) )
+			if ( *p == '<' && *(p+1) == '/' && StringEqual( p+2, value.c_str(), false, encoding ) )
 			{
-				p += endTag.length();
+				p += 2 + value.length();
 				p = SkipWhiteSpace( p, encoding );
 				if ( p && *p && *p == '>' ) {
 					++p;
@@ -1139,20 +1268,28 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 		else
 		{
 			// Try to read an attribute:
-			TiXmlAttribute* attrib = new TiXmlAttribute();
+			TiXmlAttribute* attrib = document ? document->CachedAttribute() : 0;
+			if ( !attrib )
+				attrib = new TiXmlAttribute();
 			if ( !attrib )
 			{
 				return 0;
 			}
 
-			attrib->SetDocument( document );
 			pErr = p;
 			p = attrib->Parse( p, data, encoding );
 
 			if ( !p || !*p )
 			{
-				if ( document ) document->SetError( TIXML_ERROR_PARSING_ELEMENT, pErr, data, encoding );
-				delete attrib;
+				if ( document )
+				{
+					document->SetError( TIXML_ERROR_PARSING_ELEMENT, pErr, data, encoding );
+					document->Recycle( attrib );
+				}
+				else
+				{
+					delete attrib;
+				}
 				return 0;
 			}
 
@@ -1164,12 +1301,20 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 			#endif
 			if ( node )
 			{
-				if ( document ) document->SetError( TIXML_ERROR_PARSING_ELEMENT, pErr, data, encoding );
-				delete attrib;
+				if ( document )
+				{
+					document->SetError( TIXML_ERROR_PARSING_ELEMENT, pErr, data, encoding );
+					document->Recycle( attrib );
+				}
+				else
+				{
+					delete attrib;
+				}
 				return 0;
 			}
 
 			attributeSet.Add( attrib );
+			attrib->SetOwner( this );
 		}
 	}
 	return p;
@@ -1178,7 +1323,7 @@ const char* TiXmlElement::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 
 const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
-	TiXmlDocument* document = GetDocument();
+	TiXmlDocument* document = TiXmlParseDocument( this, data );
 
 	// Read in text and elements in any order.
 	const char* pWithWhiteSpace = p;
@@ -1189,14 +1334,14 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 		if ( *p != '<' )
 		{
 			// Take what we have, make a text element.
-			TiXmlText* textNode = new TiXmlText( "" );
+			TiXmlText* textNode = TiXmlNewNode( document, TINYXML_TEXT )->AsText();
 
 			if ( !textNode )
 			{
 			    return 0;
 			}
 
-			if ( TiXmlBase::IsWhiteSpaceCondensed() )
+			if ( TiXmlCondenseWhiteSpace( data ) )
 			{
 				p = textNode->Parse( p, data, encoding );
 			}
@@ -1210,7 +1355,7 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 			if ( !textNode->Blank() )
 				LinkEndChild( textNode );
 			else
-				delete textNode;
+				TiXmlDeleteNode( document, textNode );
 		} 
 		else 
 		{
@@ -1223,11 +1368,14 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 			}
 			else
 			{
-				TiXmlNode* node = Identify( p, encoding );
+				TiXmlNode* node = Identify( p, encoding, data );
 				if ( node )
 				{
 					p = node->Parse( p, data, encoding );
-					LinkEndChild( node );
+					if ( node->type == TINYXML_COMMENT && data && !data->KeepComments() )
+						TiXmlDeleteNode( document, node );
+					else
+						LinkEndChild( node );
 				}				
 				else
 				{
@@ -1250,9 +1398,9 @@ const char* TiXmlElement::ReadValue( const char* p, TiXmlParsingData* data, TiXm
 #ifdef TIXML_USE_STL
 void TiXmlUnknown::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
-	while ( in->good() )
+	if ( in->good() )
 	{
-		int c = in->get();	
+		int c = TiXmlStreamRun( in, '>', tag );
 		if ( c <= 0 )
 		{
 			TiXmlDocument* document = GetDocument();
@@ -1260,13 +1408,8 @@ void TiXmlUnknown::StreamIn( std::istream * in, TIXML_STRING * tag )
 				document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
 			return;
 		}
-		(*tag) += (char) c;
-
-		if ( c == '>' )
-		{
-			// All is well.
-			return;		
-		}
+		// All is well.
+		(*tag) += (char) TiXmlStreamGet( in );
 	}
 }
 #endif
@@ -1274,21 +1417,17 @@ void TiXmlUnknown::StreamIn( std::istream * in, TIXML_STRING * tag )
 
 const char* TiXmlUnknown::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
-	TiXmlDocument* document = GetDocument();
+	TiXmlDocument* document = TiXmlParseDocument( this, data );
 	p = SkipWhiteSpace( p, encoding );
 
-	if ( data )
-	{
-		data->Stamp( p, encoding );
-		location = data->Cursor();
-	}
+	StampLocation( p, data, encoding );
 	if ( !p || !*p || *p != '<' )
 	{
 		if ( document ) document->SetError( TIXML_ERROR_PARSING_UNKNOWN, p, data, encoding );
 		return 0;
 	}
 	++p;
-    value = "";
+	value.resize( 0 );
 
 	while ( p && *p && *p != '>' )
 	{
@@ -1311,7 +1450,7 @@ void TiXmlComment::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
 	while ( in->good() )
 	{
-		int c = in->get();	
+		int c = TiXmlStreamRun( in, '>', tag );
 		if ( c <= 0 )
 		{
 			TiXmlDocument* document = GetDocument();
@@ -1320,10 +1459,9 @@ void TiXmlComment::StreamIn( std::istream * in, TIXML_STRING * tag )
 			return;
 		}
 
-		(*tag) += (char) c;
+		(*tag) += (char) TiXmlStreamGet( in );
 
-		if ( c == '>' 
-			 && tag->at( tag->length() - 2 ) == '-'
+		if (    tag->at( tag->length() - 2 ) == '-'
 			 && tag->at( tag->length() - 3 ) == '-' )
 		{
 			// All is well.
@@ -1336,16 +1474,12 @@ void TiXmlComment::StreamIn( std::istream * in, TIXML_STRING * tag )
 
 const char* TiXmlComment::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
-	TiXmlDocument* document = GetDocument();
-	value = "";
+	TiXmlDocument* document = TiXmlParseDocument( this, data );
+	value.resize( 0 );
 
 	p = SkipWhiteSpace( p, encoding );
 
-	if ( data )
-	{
-		data->Stamp( p, encoding );
-		location = data->Cursor();
-	}
+	StampLocation( p, data, encoding );
 	const char* startTag = "<!--";
 	const char* endTag   = "-->";
 
@@ -1375,7 +1509,6 @@ const char* TiXmlComment::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 				  <!-- declarations for <head> & <body> -->
 	*/
 
-    value = "";
 	// Keep all the white space.
 	while (	p && *p && !StringEqual( p, endTag, false, encoding ) )
 	{
@@ -1391,14 +1524,12 @@ const char* TiXmlComment::Parse( const char* p, TiXmlParsingData* data, TiXmlEnc
 
 const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
+	TiXmlDocument* document = data ? data->Document() : ( owner ? owner->GetDocument() : 0 );
 	p = SkipWhiteSpace( p, encoding );
 	if ( !p || !*p ) return 0;
 
-	if ( data )
-	{
-		data->Stamp( p, encoding );
-		location = data->Cursor();
-	}
+	StampLocation( p, data, encoding );
+	plain = false;
 	// Read the name, the '=' and the value.
 	const char* pErr = p;
 	p = ReadName( p, &name, encoding );
@@ -1443,7 +1574,7 @@ const char* TiXmlAttribute::Parse( const char* p, TiXmlParsingData* data, TiXmlE
 		// All attribute values should be in single or double quotes.
 		// But this is such a common error that the parser will try
 		// its best, even without them.
-		value = "";
+		value.resize( 0 );
 		while (    p && *p											// existence
 				&& !IsWhiteSpace( *p )								// whitespace
 				&& *p != '/' && *p != '>' )							// tag end
@@ -1467,7 +1598,9 @@ void TiXmlText::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
 	while ( in->good() )
 	{
-		int c = in->peek();	
+		// Normal text runs to the next '<'. CDATA runs to the next '>', which
+		// may or may not be the end of the "]]>" terminator.
+		int c = TiXmlStreamRun( in, cdata ? '>' : '<', tag );
 		if ( !cdata && (c == '<' ) ) 
 		{
 			return;
@@ -1480,10 +1613,9 @@ void TiXmlText::StreamIn( std::istream * in, TIXML_STRING * tag )
 			return;
 		}
 
-		(*tag) += (char) c;
-		in->get();	// "commits" the peek made above
+		(*tag) += (char) TiXmlStreamGet( in );
 
-		if ( cdata && c == '>' && tag->size() >= 3 ) {
+		if ( cdata && tag->size() >= 3 ) {
 			size_t len = tag->size();
 			if ( (*tag)[len-2] == ']' && (*tag)[len-3] == ']' ) {
 				// terminator of cdata.
@@ -1496,14 +1628,11 @@ void TiXmlText::StreamIn( std::istream * in, TIXML_STRING * tag )
 
 const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncoding encoding )
 {
-	value = "";
-	TiXmlDocument* document = GetDocument();
+	value.resize( 0 );
+	plain = false;
+	TiXmlDocument* document = TiXmlParseDocument( this, data );
 
-	if ( data )
-	{
-		data->Stamp( p, encoding );
-		location = data->Cursor();
-	}
+	StampLocation( p, data, encoding );
 
 	const char* const startTag = "<![CDATA[";
 	const char* const endTag   = "]]>";
@@ -1535,7 +1664,7 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
 	}
 	else
 	{
-		bool ignoreWhite = true;
+		bool ignoreWhite = TiXmlCondenseWhiteSpace( data );
 
 		const char* end = "<";
 		p = ReadText( p, &value, ignoreWhite, end, false, encoding );
@@ -1548,9 +1677,9 @@ const char* TiXmlText::Parse( const char* p, TiXmlParsingData* data, TiXmlEncodi
 #ifdef TIXML_USE_STL
 void TiXmlDeclaration::StreamIn( std::istream * in, TIXML_STRING * tag )
 {
-	while ( in->good() )
+	if ( in->good() )
 	{
-		int c = in->get();
+		int c = TiXmlStreamRun( in, '>', tag );
 		if ( c <= 0 )
 		{
 			TiXmlDocument* document = GetDocument();
@@ -1558,13 +1687,8 @@ void TiXmlDeclaration::StreamIn( std::istream * in, TIXML_STRING * tag )
 				document->SetError( TIXML_ERROR_EMBEDDED_NULL, 0, 0, TIXML_ENCODING_UNKNOWN );
 			return;
 		}
-		(*tag) += (char) c;
-
-		if ( c == '>' )
-		{
-			// All is well.
-			return;
-		}
+		// All is well.
+		(*tag) += (char) TiXmlStreamGet( in );
 	}
 }
 #endif
@@ -1574,49 +1698,49 @@ const char* TiXmlDeclaration::Parse( const char* p, TiXmlParsingData* data, TiXm
 	p = SkipWhiteSpace( p, _encoding );
 	// Find the beginning, find the end, and look for
 	// the stuff in-between.
-	TiXmlDocument* document = GetDocument();
+	TiXmlDocument* document = TiXmlParseDocument( this, data );
 	if ( !p || !*p || !StringEqual( p, "<?xml", true, _encoding ) )
 	{
 		if ( document ) document->SetError( TIXML_ERROR_PARSING_DECLARATION, 0, 0, _encoding );
 		return 0;
 	}
-	if ( data )
-	{
-		data->Stamp( p, _encoding );
-		location = data->Cursor();
-	}
+	StampLocation( p, data, _encoding );
 	p += 5;
 
-	version = "";
-	encoding = "";
-	standalone = "";
+	version.resize( 0 );
+	encoding.resize( 0 );
+	standalone.resize( 0 );
 
+	// The pseudo-attributes are all read through one attribute, which is
+	// borrowed from the document (if it kept any) to avoid allocating.
+	TiXmlAttribute* attrib = document ? document->CachedAttribute() : 0;
+	if ( !attrib )
+		attrib = new TiXmlAttribute();
+
+	const char* result = 0;
 	while ( p && *p )
 	{
 		if ( *p == '>' )
 		{
-			++p;
-			return p;
+			result = p+1;
+			break;
 		}
 
 		p = SkipWhiteSpace( p, _encoding );
 		if ( StringEqual( p, "version", true, _encoding ) )
 		{
-			TiXmlAttribute attrib;
-			p = attrib.Parse( p, data, _encoding );		
-			version = attrib.Value();
+			p = attrib->Parse( p, data, _encoding );		
+			version = attrib->Value();
 		}
 		else if ( StringEqual( p, "encoding", true, _encoding ) )
 		{
-			TiXmlAttribute attrib;
-			p = attrib.Parse( p, data, _encoding );		
-			encoding = attrib.Value();
+			p = attrib->Parse( p, data, _encoding );		
+			encoding = attrib->Value();
 		}
 		else if ( StringEqual( p, "standalone", true, _encoding ) )
 		{
-			TiXmlAttribute attrib;
-			p = attrib.Parse( p, data, _encoding );		
-			standalone = attrib.Value();
+			p = attrib->Parse( p, data, _encoding );		
+			standalone = attrib->Value();
 		}
 		else
 		{
@@ -1625,7 +1749,12 @@ const char* TiXmlDeclaration::Parse( const char* p, TiXmlParsingData* data, TiXm
 				++p;
 		}
 	}
-	return 0;
+
+	if ( document )
+		document->Recycle( attrib );
+	else
+		delete attrib;
+	return result;
 }
 
 bool TiXmlText::Blank() const
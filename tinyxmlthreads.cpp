@@ -0,0 +1,1581 @@
+/*
+www.sourceforge.net/projects/tinyxml
+Original code by Lee Thomason (www.grinninglizard.com)
+
+This software is provided 'as-is', without any express or implied
+warranty. In no event will the authors be held liable for any
+damages arising from the use of this software.
+
+Permission is granted to anyone to use this software for any
+purpose, including commercial applications, and to alter it and
+redistribute it freely, subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must
+not claim that you wrote the original software. If you use this
+software in a product, an acknowledgment in the product documentation
+would be appreciated but is not required.
+
+2. Altered source versions must be plainly marked as such, and
+must not be misrepresented as being the original software.
+
+3. This notice may not be removed or altered from any source
+distribution.
+*/
+
+#include "tinyxml.h"
+
+// The threading support is optional, and needs C++11 threads. This whole
+// file compiles to nothing unless TIXML_USE_THREADS is defined.
+#ifdef TIXML_USE_THREADS
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+
+#if defined( __linux__ ) && !defined( TIXML_NO_IO_URING ) && defined( __has_include )
+	#if __has_include( <linux/io_uring.h> )
+		#define TIXML_IO_URING
+	#endif
+#endif
+
+#ifdef TIXML_IO_URING
+	#include <linux/io_uring.h>
+	#include <sys/syscall.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/eventfd.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <errno.h>
+#endif
+
+FILE* TiXmlFOpen( const char* filename, const char* mode );
+
+
+struct TiXmlThreadPool::Impl
+{
+	std::mutex mutex;
+	std::condition_variable work;		// signalled when a task is queued, or on stop
+	std::condition_variable idle;		// signalled when the pool runs out of work
+	std::deque< TiXmlTask* > queue;
+	std::vector< std::thread > threads;
+	int running;
+	bool stopping;
+
+	Impl() : running( 0 ), stopping( false ) {}
+	void Worker();
+};
+
+
+void TiXmlThreadPool::Impl::Worker()
+{
+	std::unique_lock< std::mutex > lock( mutex );
+	for( ;; )
+	{
+		while ( queue.empty() && !stopping )
+			work.wait( lock );
+		if ( queue.empty() )
+			return;		// stopping, and nothing left to do
+
+		TiXmlTask* task = queue.front();
+		queue.pop_front();
+		++running;
+
+		lock.unlock();
+		task->Run();	// may delete the task
+		lock.lock();
+
+		--running;
+		if ( queue.empty() && running == 0 )
+			idle.notify_all();
+	}
+}
+
+
+TiXmlThreadPool::TiXmlThreadPool( int threads ) : impl( new Impl )
+{
+	if ( threads <= 0 )
+		threads = (int) std::thread::hardware_concurrency();
+	if ( threads <= 0 )
+		threads = 1;
+
+	for( int i=0; i<threads; ++i )
+		impl->threads.push_back( std::thread( &Impl::Worker, impl ) );
+}
+
+
+TiXmlThreadPool::~TiXmlThreadPool()
+{
+	{
+		std::lock_guard< std::mutex > lock( impl->mutex );
+		impl->stopping = true;
+	}
+	impl->work.notify_all();
+	for( size_t i=0; i<impl->threads.size(); ++i )
+		impl->threads[i].join();
+	delete impl;
+}
+
+
+void TiXmlThreadPool::Run( TiXmlTask* task )
+{
+	assert( task );
+	{
+		std::lock_guard< std::mutex > lock( impl->mutex );
+		impl->queue.push_back( task );
+	}
+	impl->work.notify_one();
+}
+
+
+void TiXmlThreadPool::Wait()
+{
+	std::unique_lock< std::mutex > lock( impl->mutex );
+	while ( !impl->queue.empty() || impl->running > 0 )
+		impl->idle.wait( lock );
+}
+
+
+int TiXmlThreadPool::ThreadCount() const
+{
+	return (int) impl->threads.size();
+}
+
+
+// The state shared by the workers of one TiXmlThreadPool::Accept(). Each
+// worker has a deque of subtrees waiting to be walked: it takes from the
+// back of its own, and steals from the front of the others'.
+class TiXmlParallelWalk
+{
+public:
+	TiXmlParallelWalk( int workers ) : queues( workers ), pending( 0 ), hungry( 0 ), running( workers ) {}
+
+	void Push( int worker, const TiXmlNode* node );
+	const TiXmlNode* Pop( int worker );
+	void Work( int worker, TiXmlVisitor* visitor );
+	void Walk( int worker, const TiXmlNode* root, TiXmlVisitor* visitor );
+	void Done();
+	void WaitDone();
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque< const TiXmlNode* > nodes;
+	};
+
+	static void Exit( const TiXmlNode* node, TiXmlVisitor* visitor );
+
+	std::vector< Queue > queues;
+	std::atomic< long > pending;	// subtrees queued or being walked
+	std::atomic< int > hungry;		// workers looking for something to steal
+
+	std::mutex mutex;
+	std::condition_variable fed;	// something was pushed, or pending hit 0
+	std::condition_variable finished;
+	int running;
+};
+
+
+class TiXmlParallelTask : public TiXmlTask
+{
+public:
+	TiXmlParallelTask( TiXmlParallelWalk* _walk, int _worker, TiXmlVisitor* _visitor ) : walk( _walk ), worker( _worker ), visitor( _visitor ) {}
+
+	virtual void Run()
+	{
+		walk->Work( worker, visitor );
+		walk->Done();
+		delete this;
+	}
+
+private:
+	TiXmlParallelWalk* walk;
+	int worker;
+	TiXmlVisitor* visitor;
+};
+
+
+void TiXmlParallelWalk::Push( int worker, const TiXmlNode* node )
+{
+	++pending;
+	{
+		std::lock_guard< std::mutex > lock( queues[worker].mutex );
+		queues[worker].nodes.push_back( node );
+	}
+	std::lock_guard< std::mutex > lock( mutex );
+	fed.notify_one();
+}
+
+
+const TiXmlNode* TiXmlParallelWalk::Pop( int worker )
+{
+	const int count = (int) queues.size();
+	for( int i=0; i<count; ++i )
+	{
+		Queue& queue = queues[ ( worker + i ) % count ];
+		std::lock_guard< std::mutex > lock( queue.mutex );
+		if ( !queue.nodes.empty() )
+		{
+			const TiXmlNode* node;
+			if ( i == 0 )
+			{
+				node = queue.nodes.back();		// our own, most recent first
+				queue.nodes.pop_back();
+			}
+			else
+			{
+				node = queue.nodes.front();		// stolen, biggest first
+				queue.nodes.pop_front();
+			}
+			return node;
+		}
+	}
+	return 0;
+}
+
+
+void TiXmlParallelWalk::Work( int worker, TiXmlVisitor* visitor )
+{
+	for( ;; )
+	{
+		const TiXmlNode* node = Pop( worker );
+		if ( !node )
+		{
+			// Sleep until another worker shares some of its subtree, or
+			// everything is done. Push() and the last --pending notify
+			// under the mutex, so checking under it can't miss them.
+			++hungry;
+			std::unique_lock< std::mutex > lock( mutex );
+			while ( !( node = Pop( worker ) ) && pending.load() > 0 )
+				fed.wait( lock );
+			lock.unlock();
+			--hungry;
+			if ( !node )
+				return;		// nothing queued, and nothing being walked
+		}
+		Walk( worker, node, visitor );
+		if ( --pending == 0 )
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			fed.notify_all();
+		}
+	}
+}
+
+
+void TiXmlParallelWalk::Exit( const TiXmlNode* node, TiXmlVisitor* visitor )
+{
+	if ( node->AsElement() )
+		visitor->VisitExit( *node->AsElement() );
+	else if ( node->AsDocument() )
+		visitor->VisitExit( *node->AsDocument() );
+}
+
+
+// Like TiXmlNode::Walk(), but hands the children of an element out to the
+// other workers when any of them is hungry.
+void TiXmlParallelWalk::Walk( int worker, const TiXmlNode* root, TiXmlVisitor* visitor )
+{
+	const TiXmlNode* node = root;
+	for( ;; )
+	{
+		bool enter = false;
+		switch ( node->Type() )
+		{
+			case TiXmlNode::TINYXML_DOCUMENT:
+				enter = visitor->VisitEnter( *node->AsDocument() );
+				break;
+			case TiXmlNode::TINYXML_ELEMENT:
+				enter = visitor->VisitEnter( *node->AsElement(), node->AsElement()->FirstAttribute() );
+				break;
+			case TiXmlNode::TINYXML_COMMENT:
+				visitor->Visit( *node->AsComment() );
+				break;
+			case TiXmlNode::TINYXML_UNKNOWN:
+				visitor->Visit( *node->AsUnknown() );
+				break;
+			case TiXmlNode::TINYXML_TEXT:
+				visitor->Visit( *node->AsText() );
+				break;
+			case TiXmlNode::TINYXML_DECLARATION:
+				visitor->Visit( *node->AsDeclaration() );
+				break;
+			default:
+				break;
+		}
+
+		const TiXmlNode* child = node->FirstChild();
+		if ( enter && child )
+		{
+			if ( hungry.load( std::memory_order_relaxed ) == 0 || !child->NextSibling() )
+			{
+				node = child;
+				continue;
+			}
+			for( ; child; child = child->NextSibling() )
+				Push( worker, child );
+		}
+		Exit( node, visitor );
+
+		// Move on to the next sibling, leaving the parents that are done.
+		for( ;; )
+		{
+			if ( node == root )
+				return;
+			if ( node->NextSibling() )
+			{
+				node = node->NextSibling();
+				break;
+			}
+			node = node->Parent();
+			Exit( node, visitor );
+		}
+	}
+}
+
+
+void TiXmlParallelWalk::Done()
+{
+	std::lock_guard< std::mutex > lock( mutex );
+	if ( --running == 0 )
+		finished.notify_all();
+}
+
+
+void TiXmlParallelWalk::WaitDone()
+{
+	std::unique_lock< std::mutex > lock( mutex );
+	while ( running > 0 )
+		finished.wait( lock );
+}
+
+
+void TiXmlThreadPool::Accept( const TiXmlNode* node, TiXmlVisitorFactory* factory )
+{
+	assert( node && factory );
+	const int workers = ThreadCount();
+
+	std::vector< TiXmlVisitor* > visitors;
+	for( int i=0; i<workers; ++i )
+		visitors.push_back( factory->Create() );
+
+	TiXmlParallelWalk walk( workers );
+	walk.Push( 0, node );
+	for( int i=0; i<workers; ++i )
+		Run( new TiXmlParallelTask( &walk, i, visitors[i] ) );
+	walk.WaitDone();
+
+	for( int i=0; i<workers; ++i )
+		factory->Reduce( visitors[i] );
+}
+
+
+// Counts the nodes in every subtree of 'root' in one pass. sizes[i] is the
+// size of the subtree at the i'th node in document order, so the first
+// child of node i is node i+1, and its next sibling is node i+sizes[i].
+static void TiXmlCountNodes( const TiXmlNode* root, std::vector< long >* sizes )
+{
+	std::vector< long > open;	// the indexes of the nodes still being counted
+	const TiXmlNode* node = root;
+	for( ;; )
+	{
+		open.push_back( (long) sizes->size() );
+		sizes->push_back( 0 );
+		if ( node->FirstChild() )
+		{
+			node = node->FirstChild();
+			continue;
+		}
+		// Close the nodes that are done, up to one with a next sibling.
+		for( ;; )
+		{
+			long index = open.back();
+			open.pop_back();
+			(*sizes)[index] = (long) sizes->size() - index;
+			if ( node == root )
+				return;
+			if ( node->NextSibling() )
+			{
+				node = node->NextSibling();
+				break;
+			}
+			node = node->Parent();
+		}
+	}
+}
+
+
+// Cuts a tree up for TiXmlThreadPool::Print(). The output is a list of
+// pieces, in order, each printed by a TiXmlPrinter of its own: the start
+// and end tags of the elements that are cut up, printed here, and runs of
+// siblings, printed by tasks on the pool.
+class TiXmlParallelPrint
+{
+public:
+	TiXmlParallelPrint( TiXmlThreadPool* _pool, TiXmlPrinter* _printer ) : pool( _pool ), printer( _printer ), grain( 0 ), running( 0 ) {}
+	~TiXmlParallelPrint();
+
+	void Print( const TiXmlNode& node );
+
+private:
+	class RunTask : public TiXmlTask
+	{
+	public:
+		RunTask( TiXmlParallelPrint* _print, TiXmlPrinter* _piece, const TiXmlNode* _first, const TiXmlNode* _end )
+			: print( _print ), piece( _piece ), first( _first ), end( _end ) {}
+
+		virtual void Run()
+		{
+			for( const TiXmlNode* node = first; node != end; node = node->NextSibling() )
+				node->Accept( piece );
+			print->Done();
+			delete this;
+		}
+
+	private:
+		TiXmlParallelPrint* print;
+		TiXmlPrinter* piece;
+		const TiXmlNode* first;
+		const TiXmlNode* end;
+	};
+
+	TiXmlPrinter* NewPiece( int depth );
+	void Split( const TiXmlNode* node, long index, int depth );
+	void PrintRun( const TiXmlNode* first, const TiXmlNode* end, int depth );
+	void Done();
+
+	TiXmlThreadPool* pool;
+	TiXmlPrinter* printer;
+	long grain;						// the number of nodes worth a task
+	std::vector< long > sizes;		// from TiXmlCountNodes()
+	std::vector< TiXmlPrinter* > pieces;
+
+	std::mutex mutex;
+	std::condition_variable finished;
+	int running;
+};
+
+
+TiXmlParallelPrint::~TiXmlParallelPrint()
+{
+	for( size_t i=0; i<pieces.size(); ++i )
+		delete pieces[i];
+}
+
+
+TiXmlPrinter* TiXmlParallelPrint::NewPiece( int depth )
+{
+	TiXmlPrinter* piece = new TiXmlPrinter();
+	piece->indent = printer->indent;
+	piece->lineBreak = printer->lineBreak;
+	piece->depth = depth;
+	pieces.push_back( piece );
+	return piece;
+}
+
+
+void TiXmlParallelPrint::PrintRun( const TiXmlNode* first, const TiXmlNode* end, int depth )
+{
+	if ( first == end )
+		return;
+	{
+		std::lock_guard< std::mutex > lock( mutex );
+		++running;
+	}
+	pool->Run( new RunTask( this, NewPiece( depth ), first, end ) );
+}
+
+
+void TiXmlParallelPrint::Done()
+{
+	std::lock_guard< std::mutex > lock( mutex );
+	if ( --running == 0 )
+		finished.notify_all();
+}
+
+
+// Prints the tags of 'node' (number 'index' in document order) here, and
+// its children as runs of about 'grain' nodes; children that are too big
+// for one run are split in turn.
+void TiXmlParallelPrint::Split( const TiXmlNode* node, long index, int depth )
+{
+	TiXmlPrinter* enter = NewPiece( depth );
+	if ( node->AsDocument() )
+		enter->VisitEnter( *node->AsDocument() );
+	else
+		enter->VisitEnter( *node->AsElement(), node->AsElement()->FirstAttribute() );
+
+	// The printer indents the children of an element, but not of a document.
+	const int childDepth = node->AsDocument() ? depth : depth + 1;
+	const TiXmlNode* first = node->FirstChild();
+	long size = 0;
+	long childIndex = index + 1;
+	for( const TiXmlNode* child = node->FirstChild(); child; )
+	{
+		const TiXmlNode* next = child->NextSibling();
+		long count = sizes[ childIndex ];
+		if ( count > grain && child->AsElement() && child->FirstChild() != child->LastChild() )
+		{
+			PrintRun( first, child, childDepth );
+			Split( child, childIndex, childDepth );
+			first = next;
+			size = 0;
+		}
+		else
+		{
+			size += count;
+			if ( size >= grain )
+			{
+				PrintRun( first, next, childDepth );
+				first = next;
+				size = 0;
+			}
+		}
+		child = next;
+		childIndex += count;
+	}
+	PrintRun( first, 0, childDepth );
+
+	TiXmlPrinter* exit = NewPiece( childDepth );
+	if ( node->AsDocument() )
+		exit->VisitExit( *node->AsDocument() );
+	else
+		exit->VisitExit( *node->AsElement() );
+}
+
+
+void TiXmlParallelPrint::Print( const TiXmlNode& node )
+{
+	TiXmlCountNodes( &node, &sizes );
+	const long total = sizes[0];
+	grain = total / ( pool->ThreadCount() * 8 );
+	if ( grain < 256 )
+		grain = 256;
+
+	if ( total <= grain || !( node.AsElement() || node.AsDocument() ) )
+	{
+		node.Accept( printer );
+		return;
+	}
+
+	Split( &node, 0, printer->depth );
+	{
+		std::unique_lock< std::mutex > lock( mutex );
+		while ( running > 0 )
+			finished.wait( lock );
+	}
+
+	TiXmlOutputBuffer& output = printer->output;
+	if ( output.sink )
+	{
+		// Hand the pieces over as they are, rather than copying them.
+		output.Flush();
+		for( size_t i=0; i<pieces.size(); ++i )
+		{
+			const TIXML_STRING& buffer = pieces[i]->output.buffer;
+			if ( buffer.length() > 0 && !output.sink->Write( buffer.c_str(), (int) buffer.length() ) )
+				output.sinkError = true;
+		}
+	}
+	else
+	{
+		size_t length = output.buffer.length();
+		for( size_t i=0; i<pieces.size(); ++i )
+			length += pieces[i]->output.buffer.length();
+		output.buffer.reserve( length );
+		for( size_t i=0; i<pieces.size(); ++i )
+			output.buffer.append( pieces[i]->output.buffer.c_str(), pieces[i]->output.buffer.length() );
+	}
+}
+
+
+void TiXmlThreadPool::Print( const TiXmlNode& node, TiXmlPrinter* printer )
+{
+	assert( printer );
+	TiXmlParallelPrint print( this, printer );
+	print.Print( node );
+}
+
+
+// One load or save making its way through TiXmlAsyncIO. It goes from the
+// caller to the ring (or straight to the pool), and from there to the
+// pool, which finishes it off by calling the handler.
+struct TiXmlAsyncRequest
+{
+	TiXmlAsyncIOImpl* io;
+	TiXmlAsyncHandler* handler;
+	TiXmlDocument* loadDoc;			// set for a load
+	const TiXmlDocument* saveDoc;	// set for a save
+	TIXML_STRING filename;
+	TiXmlEncoding encoding;
+
+	int fd;
+	char* buffer;					// file contents being read, or printed output being written
+	long length;
+	long done;						// bytes read or written so far
+	bool success;
+	bool fallback;					// the ring couldn't do it; use blocking I/O on the pool
+
+	TiXmlAsyncRequest() : io( 0 ), handler( 0 ), loadDoc( 0 ), saveDoc( 0 ), encoding( TIXML_DEFAULT_ENCODING ),
+						  fd( -1 ), buffer( 0 ), length( 0 ), done( 0 ), success( false ), fallback( false ) {}
+	~TiXmlAsyncRequest()			{ delete [] buffer; }
+};
+
+
+#ifdef TIXML_IO_URING
+
+// A minimal io_uring, driven through the raw system calls so there is no
+// dependency on liburing. One thread owns the ring: it opens the files,
+// keeps the submission queue full, and hands each request on to the pool
+// once its I/O is done. Other threads add requests with Submit(), which
+// wakes the ring thread through an eventfd read that is always in flight.
+// If the ring stops working, the thread finishes what it has and leaves,
+// and the pool does any I/O that comes after.
+class TiXmlRing
+{
+public:
+	static TiXmlRing* Create( TiXmlThreadPool* pool );
+	~TiXmlRing();
+
+	void Submit( TiXmlAsyncRequest* request );
+
+private:
+	TiXmlRing( TiXmlThreadPool* pool );
+	bool Init();
+	void Loop();
+	void Open( TiXmlAsyncRequest* request );
+	bool Push( int op, int fd, void* addr, unsigned len, long offset, void* userData );
+	void Complete( TiXmlAsyncRequest* request );
+	void Landed( TiXmlAsyncRequest* request );
+	void Abandon();
+
+	TiXmlThreadPool* pool;
+	int ringFd;
+	int eventFd;
+	unsigned long long eventValue;
+
+	void* sqPtr;
+	size_t sqSize;
+	void* cqPtr;
+	size_t cqSize;
+	io_uring_sqe* sqes;
+	size_t sqesSize;
+
+	unsigned* sqHead;
+	unsigned* sqTail;
+	unsigned* sqMask;
+	unsigned* sqArray;
+	unsigned sqEntries;
+	unsigned* cqHead;
+	unsigned* cqTail;
+	unsigned* cqMask;
+	io_uring_cqe* cqes;
+
+	std::thread thread;
+	std::mutex mutex;
+	std::deque< TiXmlAsyncRequest* > incoming;	// guarded by mutex
+	bool stopping;								// guarded by mutex
+	bool broken;								// guarded by mutex
+	std::deque< TiXmlAsyncRequest* > ready;		// ring thread only: waiting for a submission slot
+	std::vector< TiXmlAsyncRequest* > inFlight;	// ring thread only: given to the kernel
+	std::vector< char* > orphans;				// buffers the kernel may still have, freed last
+};
+
+#endif	// TIXML_IO_URING
+
+
+class TiXmlAsyncIOImpl
+{
+public:
+	TiXmlThreadPool* pool;
+	bool ownsPool;
+	#ifdef TIXML_IO_URING
+	TiXmlRing* ring;
+	#endif
+
+	std::mutex mutex;
+	std::condition_variable done;
+	int outstanding;
+
+	void Finish( TiXmlAsyncRequest* request );
+};
+
+
+namespace {
+
+// Prints the document being saved in to request->buffer, byte for byte as
+// SaveFile() writes it: through SaveFile( FILE* ), so the layout is the same
+// and Print() overrides are honoured. The stream is in memory, or a
+// temporary file where there is no open_memstream().
+bool TiXmlPrintForSave( TiXmlAsyncRequest* request )
+{
+	#ifdef _WIN32
+	FILE* fp = tmpfile();
+	if ( !fp )
+		return false;
+	bool result = request->saveDoc->SaveFile( fp );
+	long size = ftell( fp );
+	if ( result && size >= 0 )
+	{
+		rewind( fp );
+		request->length = size;
+		request->buffer = new char[ size + 1 ];
+		result = fread( request->buffer, 1, size, fp ) == (size_t) size;
+	}
+	fclose( fp );
+	return result && size >= 0;
+	#else
+	char* data = 0;
+	size_t size = 0;
+	FILE* fp = open_memstream( &data, &size );
+	if ( !fp )
+		return false;
+	bool result = request->saveDoc->SaveFile( fp );
+	result = ( fclose( fp ) == 0 ) && result;	// data and size are final once closed
+	if ( result )
+	{
+		request->length = (long) size;
+		request->buffer = new char[ size + 1 ];
+		memcpy( request->buffer, data, size );
+	}
+	free( data );
+	return result;
+	#endif
+}
+
+
+// Writes out the buffer TiXmlPrintForSave() made, opening the file the way
+// SaveFile() does.
+bool TiXmlWriteSaved( TiXmlAsyncRequest* request )
+{
+	FILE* fp = TiXmlFOpen( request->filename.c_str(), "w" );
+	if ( !fp )
+		return false;
+	bool written = fwrite( request->buffer, 1, request->length, fp ) == (size_t) request->length;
+	return ( fclose( fp ) == 0 ) && written;
+}
+
+
+// Loads or saves with the ordinary blocking calls. Used when there's no
+// ring at all.
+class TiXmlBlockingTask : public TiXmlTask
+{
+public:
+	TiXmlBlockingTask( TiXmlAsyncRequest* _request ) : request( _request ) {}
+	virtual void Run()
+	{
+		if ( request->loadDoc )
+			request->success = request->loadDoc->LoadFile( request->filename.c_str(), request->encoding );
+		else
+			request->success = TiXmlPrintForSave( request ) && TiXmlWriteSaved( request );
+		request->io->Finish( request );
+		delete this;
+	}
+private:
+	TiXmlAsyncRequest* request;
+};
+
+
+// Parses a file the ring has read in, or picks up after the ring gave up.
+class TiXmlParseTask : public TiXmlTask
+{
+public:
+	TiXmlParseTask( TiXmlAsyncRequest* _request ) : request( _request ) {}
+	virtual void Run()
+	{
+		TiXmlDocument* doc = request->loadDoc;
+		if ( request->fallback )
+		{
+			request->success = doc->LoadFile( request->filename.c_str(), request->encoding );
+		}
+		else if ( !request->buffer )
+		{
+			doc->Clear();
+			doc->SetValue( request->filename.c_str() );
+			doc->SetError( TiXmlBase::TIXML_ERROR_OPENING_FILE, 0, 0, TIXML_ENCODING_UNKNOWN );
+			request->success = false;
+		}
+		else
+		{
+			doc->SetValue( request->filename.c_str() );
+			TiXmlMemoryInputSource source( request->buffer, request->done );
+			request->success = doc->LoadFile( &source, request->encoding );
+		}
+		request->io->Finish( request );
+		delete this;
+	}
+private:
+	TiXmlAsyncRequest* request;
+};
+
+
+// Finishes a save: either the ring wrote it, or it gave up and the
+// printed output is written here.
+class TiXmlSavedTask : public TiXmlTask
+{
+public:
+	TiXmlSavedTask( TiXmlAsyncRequest* _request ) : request( _request ) {}
+	virtual void Run()
+	{
+		if ( request->fallback )
+			request->success = TiXmlWriteSaved( request );
+		request->io->Finish( request );
+		delete this;
+	}
+private:
+	TiXmlAsyncRequest* request;
+};
+
+}	// namespace
+
+
+#ifdef TIXML_IO_URING
+
+namespace {
+
+// Prints a document to memory, ready for the ring to write out.
+class TiXmlPrintTask : public TiXmlTask
+{
+public:
+	TiXmlPrintTask( TiXmlAsyncRequest* _request, TiXmlRing* _ring ) : request( _request ), ring( _ring ) {}
+	virtual void Run()
+	{
+		if ( TiXmlPrintForSave( request ) )
+		{
+			ring->Submit( request );
+		}
+		else
+		{
+			request->success = false;
+			request->io->Finish( request );
+		}
+		delete this;
+	}
+private:
+	TiXmlAsyncRequest* request;
+	TiXmlRing* ring;
+};
+
+}	// namespace
+
+
+TiXmlRing::TiXmlRing( TiXmlThreadPool* _pool )
+	: pool( _pool ), ringFd( -1 ), eventFd( -1 ), eventValue( 0 ),
+	  sqPtr( MAP_FAILED ), sqSize( 0 ), cqPtr( MAP_FAILED ), cqSize( 0 ), sqes( (io_uring_sqe*) MAP_FAILED ), sqesSize( 0 ),
+	  sqHead( 0 ), sqTail( 0 ), sqMask( 0 ), sqArray( 0 ), sqEntries( 0 ),
+	  cqHead( 0 ), cqTail( 0 ), cqMask( 0 ), cqes( 0 ),
+	  stopping( false ), broken( false )
+{
+}
+
+
+TiXmlRing* TiXmlRing::Create( TiXmlThreadPool* pool )
+{
+	TiXmlRing* ring = new TiXmlRing( pool );
+	if ( !ring->Init() )
+	{
+		delete ring;
+		return 0;
+	}
+	ring->thread = std::thread( &TiXmlRing::Loop, ring );
+	return ring;
+}
+
+
+bool TiXmlRing::Init()
+{
+	io_uring_params params;
+	memset( &params, 0, sizeof( params ) );
+
+	ringFd = (int) syscall( __NR_io_uring_setup, 64, &params );
+	if ( ringFd < 0 )
+		return false;		// no kernel support, or not allowed here
+
+	// Plain reads and writes (IORING_OP_READ / WRITE) arrived along with
+	// IORING_FEAT_RW_CUR_POS, in Linux 5.6. Older rings can't be used.
+	if ( !( params.features & IORING_FEAT_RW_CUR_POS ) )
+		return false;
+
+	sqSize = params.sq_off.array + params.sq_entries * sizeof( unsigned );
+	cqSize = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+	bool singleMap = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+	if ( singleMap )
+	{
+		if ( cqSize > sqSize )
+			sqSize = cqSize;
+		cqSize = sqSize;
+	}
+
+	sqPtr = mmap( 0, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING );
+	if ( sqPtr == MAP_FAILED )
+		return false;
+	if ( singleMap )
+	{
+		cqPtr = sqPtr;
+	}
+	else
+	{
+		cqPtr = mmap( 0, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING );
+		if ( cqPtr == MAP_FAILED )
+			return false;
+	}
+	sqesSize = params.sq_entries * sizeof( io_uring_sqe );
+	sqes = (io_uring_sqe*) mmap( 0, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES );
+	if ( sqes == MAP_FAILED )
+		return false;
+
+	char* sq = (char*) sqPtr;
+	sqHead		= (unsigned*)( sq + params.sq_off.head );
+	sqTail		= (unsigned*)( sq + params.sq_off.tail );
+	sqMask		= (unsigned*)( sq + params.sq_off.ring_mask );
+	sqArray		= (unsigned*)( sq + params.sq_off.array );
+	sqEntries	= params.sq_entries;
+
+	char* cq = (char*) cqPtr;
+	cqHead		= (unsigned*)( cq + params.cq_off.head );
+	cqTail		= (unsigned*)( cq + params.cq_off.tail );
+	cqMask		= (unsigned*)( cq + params.cq_off.ring_mask );
+	cqes		= (io_uring_cqe*)( cq + params.cq_off.cqes );
+
+	eventFd = eventfd( 0, EFD_CLOEXEC );
+	return eventFd >= 0;
+}
+
+
+TiXmlRing::~TiXmlRing()
+{
+	if ( thread.joinable() )
+	{
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			stopping = true;
+		}
+		unsigned long long one = 1;
+		if ( write( eventFd, &one, sizeof( one ) ) < 0 ) {}
+		thread.join();
+	}
+
+	if ( sqes != MAP_FAILED )
+		munmap( sqes, sqesSize );
+	if ( cqPtr != MAP_FAILED && cqPtr != sqPtr )
+		munmap( cqPtr, cqSize );
+	if ( sqPtr != MAP_FAILED )
+		munmap( sqPtr, sqSize );
+	if ( ringFd >= 0 )
+		close( ringFd );		// cancels anything a broken ring still had
+	if ( eventFd >= 0 )
+		close( eventFd );
+	for( size_t i=0; i<orphans.size(); ++i )
+		delete [] orphans[i];
+}
+
+
+void TiXmlRing::Submit( TiXmlAsyncRequest* request )
+{
+	bool useRing;
+	{
+		std::lock_guard< std::mutex > lock( mutex );
+		useRing = !broken;
+		if ( useRing )
+			incoming.push_back( request );
+	}
+	if ( !useRing )
+	{
+		request->fallback = true;
+		Complete( request );
+		return;
+	}
+	unsigned long long one = 1;
+	if ( write( eventFd, &one, sizeof( one ) ) < 0 ) {}
+}
+
+
+// Queue one operation. Returns false if the submission queue is full.
+bool TiXmlRing::Push( int op, int fd, void* addr, unsigned len, long offset, void* userData )
+{
+	unsigned tail = *sqTail;
+	unsigned head = __atomic_load_n( sqHead, __ATOMIC_ACQUIRE );
+	if ( tail - head >= sqEntries )
+		return false;
+
+	unsigned index = tail & *sqMask;
+	io_uring_sqe* sqe = &sqes[ index ];
+	memset( sqe, 0, sizeof( *sqe ) );
+	sqe->opcode = (unsigned char) op;
+	sqe->fd = fd;
+	sqe->addr = (unsigned long long)(size_t) addr;
+	sqe->len = len;
+	sqe->off = (unsigned long long) offset;
+	sqe->user_data = (unsigned long long)(size_t) userData;
+	sqArray[ index ] = index;
+
+	__atomic_store_n( sqTail, tail + 1, __ATOMIC_RELEASE );
+	return true;
+}
+
+
+// Open the file for a new request, and get it ready to be queued.
+void TiXmlRing::Open( TiXmlAsyncRequest* request )
+{
+	if ( request->loadDoc )
+	{
+		request->fd = open( request->filename.c_str(), O_RDONLY | O_CLOEXEC );
+		if ( request->fd < 0 )
+		{
+			Complete( request );		// no buffer: reported as a failure to open
+			return;
+		}
+		struct stat st;
+		if ( fstat( request->fd, &st ) != 0 || !S_ISREG( st.st_mode ) || st.st_size >= 0x7fffffff )
+		{
+			// Pipes and the like don't have a size to read up front.
+			request->fallback = true;
+			Complete( request );
+			return;
+		}
+		request->length = (long) st.st_size;
+		request->buffer = new char[ request->length + 1 ];
+	}
+	else
+	{
+		request->fd = open( request->filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666 );
+		if ( request->fd < 0 )
+		{
+			request->fallback = true;	// let fopen() have a go, and report the error
+			Complete( request );
+			return;
+		}
+	}
+
+	if ( request->length == 0 )
+		Complete( request );
+	else
+		ready.push_back( request );
+}
+
+
+// A completion for 'request' came back from the kernel.
+void TiXmlRing::Landed( TiXmlAsyncRequest* request )
+{
+	for( size_t i=0; i<inFlight.size(); ++i )
+	{
+		if ( inFlight[i] == request )
+		{
+			inFlight[i] = inFlight.back();
+			inFlight.pop_back();
+			return;
+		}
+	}
+}
+
+
+// The ring is broken: io_uring_enter() failed in a way retrying won't fix.
+// Whatever the kernel hasn't been given yet is handed to the pool to do
+// with the plain calls. What it has can't be waited for: those requests
+// fail, and their buffers are kept until the ring is closed.
+void TiXmlRing::Abandon()
+{
+	std::deque< TiXmlAsyncRequest* > waiting;
+	{
+		std::lock_guard< std::mutex > lock( mutex );
+		broken = true;
+		waiting.swap( incoming );
+	}
+	waiting.insert( waiting.end(), ready.begin(), ready.end() );
+	ready.clear();
+	for( size_t i=0; i<waiting.size(); ++i )
+	{
+		waiting[i]->fallback = true;
+		Complete( waiting[i] );
+	}
+
+	for( size_t i=0; i<inFlight.size(); ++i )
+	{
+		TiXmlAsyncRequest* request = inFlight[i];
+		if ( request->buffer )
+			orphans.push_back( request->buffer );
+		request->buffer = 0;	// a load without a buffer fails to open
+		request->done = 0;		// a save that isn't all done fails
+		Complete( request );
+	}
+	inFlight.clear();
+}
+
+
+// The I/O for a request is over, one way or another. Hand it to the pool.
+void TiXmlRing::Complete( TiXmlAsyncRequest* request )
+{
+	if ( request->fd >= 0 )
+	{
+		if ( close( request->fd ) != 0 && request->saveDoc )
+			request->fallback = true;
+		request->fd = -1;
+	}
+
+	if ( request->loadDoc )
+	{
+		pool->Run( new TiXmlParseTask( request ) );
+	}
+	else
+	{
+		request->success = !request->fallback && request->done == request->length;
+		pool->Run( new TiXmlSavedTask( request ) );
+	}
+}
+
+
+void TiXmlRing::Loop()
+{
+	// Keep a read of the eventfd in flight, so Submit() can wake us up.
+	bool eventArmed = false;
+
+	for( ;; )
+	{
+		// Take the new requests, and open their files once the lock is
+		// released: open() can be slow, and Submit() shouldn't wait on it.
+		bool stop = false;
+		std::deque< TiXmlAsyncRequest* > opening;
+		{
+			std::lock_guard< std::mutex > lock( mutex );
+			opening.swap( incoming );
+			stop = stopping;
+		}
+		while ( !opening.empty() )
+		{
+			TiXmlAsyncRequest* request = opening.front();
+			opening.pop_front();
+			Open( request );
+		}
+		// The eventfd read has to come back before the ring can be closed.
+		// Stopping is always followed by a write to the eventfd, so it will.
+		if ( stop && inFlight.empty() && ready.empty() && !eventArmed )
+			break;
+
+		if ( !stop && !eventArmed && Push( IORING_OP_READ, eventFd, &eventValue, sizeof( eventValue ), 0, 0 ) )
+			eventArmed = true;
+
+		while ( !ready.empty() )
+		{
+			TiXmlAsyncRequest* request = ready.front();
+			long left = request->length - request->done;
+			unsigned chunk = left > 0x40000000L ? 0x40000000U : (unsigned) left;
+			int op = request->loadDoc ? IORING_OP_READ : IORING_OP_WRITE;
+			if ( !Push( op, request->fd, request->buffer + request->done, chunk, request->done, request ) )
+				break;
+			ready.pop_front();
+			inFlight.push_back( request );
+		}
+
+		// Submit everything queued, and sleep until something completes.
+		unsigned toSubmit = *sqTail - __atomic_load_n( sqHead, __ATOMIC_ACQUIRE );
+		int result = (int) syscall( __NR_io_uring_enter, ringFd, toSubmit, 1, IORING_ENTER_GETEVENTS, 0, 0 );
+		if ( result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY )
+		{
+			Abandon();
+			return;
+		}
+
+		unsigned head = *cqHead;
+		unsigned tail = __atomic_load_n( cqTail, __ATOMIC_ACQUIRE );
+		while ( head != tail )
+		{
+			io_uring_cqe* cqe = &cqes[ head & *cqMask ];
+			TiXmlAsyncRequest* request = (TiXmlAsyncRequest*)(size_t) cqe->user_data;
+			int res = cqe->res;
+			++head;
+
+			if ( !request )
+			{
+				eventArmed = false;
+				continue;
+			}
+
+			Landed( request );
+			if ( res == -EINTR || res == -EAGAIN )
+			{
+				ready.push_back( request );
+			}
+			else if ( res < 0 )
+			{
+				// The ring couldn't do this one; the pool can try the plain calls.
+				request->fallback = true;
+				Complete( request );
+			}
+			else if ( res == 0 )
+			{
+				// The file got shorter (or stopped taking data) under us.
+				if ( request->saveDoc )
+					request->fallback = true;
+				Complete( request );
+			}
+			else
+			{
+				request->done += res;
+				if ( request->done < request->length )
+					ready.push_back( request );
+				else
+					Complete( request );
+			}
+		}
+		__atomic_store_n( cqHead, head, __ATOMIC_RELEASE );
+	}
+}
+
+#endif	// TIXML_IO_URING
+
+
+void TiXmlAsyncIOImpl::Finish( TiXmlAsyncRequest* request )
+{
+	if ( request->handler )
+	{
+		if ( request->loadDoc )
+			request->handler->LoadComplete( request->loadDoc, request->success );
+		else
+			request->handler->SaveComplete( request->saveDoc, request->success );
+	}
+	delete request;
+
+	std::lock_guard< std::mutex > lock( mutex );
+	if ( --outstanding == 0 )
+		done.notify_all();
+}
+
+
+TiXmlAsyncIO::TiXmlAsyncIO( TiXmlThreadPool* pool ) : impl( new TiXmlAsyncIOImpl )
+{
+	impl->ownsPool = ( pool == 0 );
+	impl->pool = pool ? pool : new TiXmlThreadPool();
+	impl->outstanding = 0;
+	#ifdef TIXML_IO_URING
+	impl->ring = TiXmlRing::Create( impl->pool );
+	#endif
+}
+
+
+TiXmlAsyncIO::~TiXmlAsyncIO()
+{
+	Wait();
+	#ifdef TIXML_IO_URING
+	delete impl->ring;
+	#endif
+	if ( impl->ownsPool )
+		delete impl->pool;
+	delete impl;
+}
+
+
+void TiXmlAsyncIO::LoadFile( TiXmlDocument* doc, const char* filename, TiXmlAsyncHandler* handler, TiXmlEncoding encoding )
+{
+	assert( doc && filename );
+
+	TiXmlAsyncRequest* request = new TiXmlAsyncRequest();
+	request->io = impl;
+	request->handler = handler;
+	request->loadDoc = doc;
+	request->filename = filename;
+	request->encoding = encoding;
+
+	{
+		std::lock_guard< std::mutex > lock( impl->mutex );
+		++impl->outstanding;
+	}
+
+	#ifdef TIXML_IO_URING
+	if ( impl->ring )
+	{
+		impl->ring->Submit( request );
+		return;
+	}
+	#endif
+	impl->pool->Run( new TiXmlBlockingTask( request ) );
+}
+
+
+void TiXmlAsyncIO::SaveFile( const TiXmlDocument* doc, const char* filename, TiXmlAsyncHandler* handler )
+{
+	assert( doc && filename );
+
+	TiXmlAsyncRequest* request = new TiXmlAsyncRequest();
+	request->io = impl;
+	request->handler = handler;
+	request->saveDoc = doc;
+	request->filename = filename;
+
+	{
+		std::lock_guard< std::mutex > lock( impl->mutex );
+		++impl->outstanding;
+	}
+
+	#ifdef TIXML_IO_URING
+	if ( impl->ring )
+	{
+		impl->pool->Run( new TiXmlPrintTask( request, impl->ring ) );
+		return;
+	}
+	#endif
+	impl->pool->Run( new TiXmlBlockingTask( request ) );
+}
+
+
+void TiXmlAsyncIO::Wait()
+{
+	std::unique_lock< std::mutex > lock( impl->mutex );
+	while ( impl->outstanding > 0 )
+		impl->done.wait( lock );
+}
+
+
+bool TiXmlAsyncIO::UsesIoUring() const
+{
+	#ifdef TIXML_IO_URING
+	return impl->ring != 0;
+	#else
+	return false;
+	#endif
+}
+
+struct TiXmlReclaimer::Impl
+{
+	std::mutex mutex;
+	std::condition_variable work;		// signalled when a node is queued, or on stop
+	std::condition_variable idle;		// signalled when the queue has been emptied
+	std::vector< TiXmlNode* > queue;
+	std::thread thread;
+	bool deleting;
+	bool stopping;
+
+	Impl() : deleting( false ), stopping( false ) {}
+	void Worker();
+};
+
+
+void TiXmlReclaimer::Impl::Worker()
+{
+	std::vector< TiXmlNode* > batch;
+	std::unique_lock< std::mutex > lock( mutex );
+	for( ;; )
+	{
+		while ( queue.empty() && !stopping )
+			work.wait( lock );
+		if ( queue.empty() )
+			return;
+
+		// Take everything queued in one go, and delete it without the lock.
+		batch.swap( queue );
+		deleting = true;
+		lock.unlock();
+
+		for( size_t i=0; i<batch.size(); ++i )
+			delete batch[i];
+		batch.clear();
+
+		lock.lock();
+		deleting = false;
+		if ( queue.empty() )
+			idle.notify_all();
+	}
+}
+
+
+TiXmlReclaimer::TiXmlReclaimer() : impl( new Impl )
+{
+	impl->thread = std::thread( &Impl::Worker, impl );
+}
+
+
+TiXmlReclaimer::~TiXmlReclaimer()
+{
+	{
+		std::lock_guard< std::mutex > lock( impl->mutex );
+		impl->stopping = true;
+	}
+	impl->work.notify_all();
+	impl->thread.join();
+	delete impl;
+}
+
+
+void TiXmlReclaimer::Reclaim( TiXmlNode* node )
+{
+	if ( !node )
+		return;
+	assert( node->Parent() == 0 );
+	{
+		std::lock_guard< std::mutex > lock( impl->mutex );
+		impl->queue.push_back( node );
+	}
+	impl->work.notify_one();
+}
+
+
+void TiXmlReclaimer::Wait()
+{
+	std::unique_lock< std::mutex > lock( impl->mutex );
+	while ( !impl->queue.empty() || impl->deleting )
+		impl->idle.wait( lock );
+}
+
+
+// One published document, and the count of the snapshots (and the holder)
+// referring to it.
+class TiXmlDocumentVersion
+{
+public:
+	TiXmlDocumentVersion( TiXmlDocument* _doc, unsigned long _generation, TiXmlReclaimer* _reclaimer )
+		: doc( _doc ), generation( _generation ), reclaimer( _reclaimer ), refs( 1 ) {}
+
+	void Acquire()	{ refs.fetch_add( 1, std::memory_order_relaxed ); }
+	void Release()
+	{
+		if ( refs.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+		{
+			if ( reclaimer )
+				reclaimer->Reclaim( doc );
+			else
+				delete doc;
+			delete this;
+		}
+	}
+
+	TiXmlDocument* doc;
+	unsigned long generation;
+	TiXmlReclaimer* reclaimer;
+
+private:
+	std::atomic< long > refs;
+};
+
+
+class TiXmlDocumentHolderImpl
+{
+public:
+	TiXmlDocumentHolderImpl( TiXmlReclaimer* _reclaimer ) : current( 0 ), epoch( 0 ), reclaimer( _reclaimer ), generation( 0 )
+	{
+		readers[0] = 0;
+		readers[1] = 0;
+	}
+
+	void WaitForReaders();
+
+	std::atomic< TiXmlDocumentVersion* > current;
+
+	// A reader loads 'current' and then takes a reference on it. A version
+	// that has just been replaced can't be released until every reader that
+	// might have loaded it has taken its reference (or not). Readers are
+	// counted, while they do that, under the parity of the epoch they
+	// started in.
+	std::atomic< unsigned > epoch;
+	std::atomic< long > readers[2];
+
+	std::mutex writer;					// one Publish() at a time
+	TiXmlReclaimer* reclaimer;
+	unsigned long generation;
+};
+
+
+void TiXmlDocumentHolderImpl::WaitForReaders()
+{
+	// Moving the epoch on twice, and waiting each time for the readers of
+	// the epoch left behind, waits out every reader that started before:
+	// even one that read the epoch long ago and counted itself late. The
+	// readers only hold up the writer for the few instructions in Snapshot(),
+	// never the other way round.
+	for( int i=0; i<2; ++i )
+	{
+		unsigned old = epoch.fetch_add( 1 );
+		while ( readers[ old & 1 ].load() != 0 )
+			std::this_thread::yield();
+	}
+}
+
+
+TiXmlSnapshot::TiXmlSnapshot( const TiXmlSnapshot& copy ) : version( copy.version )
+{
+	if ( version )
+		version->Acquire();
+}
+
+
+TiXmlSnapshot& TiXmlSnapshot::operator=( const TiXmlSnapshot& copy )
+{
+	if ( copy.version )
+		copy.version->Acquire();
+	if ( version )
+		version->Release();
+	version = copy.version;
+	return *this;
+}
+
+
+TiXmlSnapshot::~TiXmlSnapshot()
+{
+	if ( version )
+		version->Release();
+}
+
+
+const TiXmlDocument* TiXmlSnapshot::Document() const
+{
+	return version ? version->doc : 0;
+}
+
+
+unsigned long TiXmlSnapshot::Generation() const
+{
+	return version ? version->generation : 0;
+}
+
+
+TiXmlDocumentHolder::TiXmlDocumentHolder( TiXmlReclaimer* reclaimer ) : impl( new TiXmlDocumentHolderImpl( reclaimer ) )
+{
+}
+
+
+TiXmlDocumentHolder::~TiXmlDocumentHolder()
+{
+	TiXmlDocumentVersion* version = impl->current.load();
+	if ( version )
+		version->Release();
+	delete impl;
+}
+
+
+TiXmlSnapshot TiXmlDocumentHolder::Snapshot() const
+{
+	unsigned parity = impl->epoch.load() & 1;
+	impl->readers[ parity ].fetch_add( 1 );
+	TiXmlDocumentVersion* version = impl->current.load();
+	if ( version )
+		version->Acquire();
+	impl->readers[ parity ].fetch_sub( 1 );
+	return TiXmlSnapshot( version );
+}
+
+
+void TiXmlDocumentHolder::Publish( TiXmlDocument* doc )
+{
+	assert( doc );
+	std::lock_guard< std::mutex > lock( impl->writer );
+	TiXmlDocumentVersion* version = new TiXmlDocumentVersion( doc, ++impl->generation, impl->reclaimer );
+	TiXmlDocumentVersion* old = impl->current.exchange( version );
+	if ( old )
+	{
+		impl->WaitForReaders();
+		old->Release();
+	}
+}
+
+
+TiXmlDocument* TiXmlDocumentHolder::CopyCurrent() const
+{
+	TiXmlSnapshot snapshot = Snapshot();
+	if ( snapshot.Document() )
+		return new TiXmlDocument( *snapshot.Document() );
+	return new TiXmlDocument();
+}
+
+#endif	// TIXML_USE_THREADS
@@ -6,6 +6,7 @@
 #ifdef TIXML_USE_STL
 	#include <iostream>
 	#include <sstream>
+	#include <algorithm>
 	using namespace std;
 #else
 	#include <stdio.h>
@@ -19,6 +20,10 @@
 
 #include "tinyxml.h"
 
+#ifdef TIXML_USE_THREADS
+	#include <mutex>
+#endif
+
 bool XmlTest (const char* testString, const char* expected, const char* found, bool noEcho = false);
 bool XmlTest( const char* testString, int expected, int found, bool noEcho = false );
 
@@ -75,6 +80,326 @@ bool XmlTest( const char* testString, int expected, int found, bool noEcho )
 // what is in the XML file. But it does test the basic operations,
 // and show how to add and remove nodes.
 //
+// Hands out its text one byte at a time, and claims to be smaller than it
+// is, to exercise the block handling of TiXmlDocument::LoadFile().
+class TrickleInputSource : public TiXmlInputSource
+{
+public:
+	TrickleInputSource( const char* _text ) : text( _text ) {}
+
+	virtual int Read( char* buffer, int bufferSize )
+	{
+		if ( !*text || bufferSize < 1 )
+			return 0;
+		*buffer = *text++;
+		return 1;
+	}
+	virtual long Size() const	{ return *text ? 1 : 0; }
+
+private:
+	const char* text;
+};
+
+
+class FailingInputSource : public TiXmlInputSource
+{
+public:
+	virtual int Read( char*, int )	{ return -1; }
+};
+
+
+// Keeps what a printer sends it, and how.
+class CollectingSink : public TiXmlOutputSink
+{
+public:
+	CollectingSink() : writes( 0 ), largest( 0 ) {}
+	virtual bool Write( const char* data, int size )
+	{
+		output.append( data, size );
+		++writes;
+		if ( size > largest )
+			largest = size;
+		return true;
+	}
+
+	TIXML_STRING output;
+	int writes;
+	int largest;
+};
+
+
+class FailingOutputSink : public TiXmlOutputSink
+{
+public:
+	virtual bool Write( const char*, int )	{ return false; }
+};
+
+
+// Prints itself its own way, to check that SaveFile() calls it.
+class RedactedText : public TiXmlText
+{
+public:
+	RedactedText( const char* text ) : TiXmlText( text ) {}
+	virtual void Print( FILE* cfile, int /*depth*/ ) const	{ fputs( "***", cfile ); }
+};
+
+
+// Writes down the callbacks it gets, and stops at anything named "stop" or
+// "skip". Used to check TiXmlNode::Walk() against Accept().
+class RecordingVisitor : public TiXmlVisitor
+{
+public:
+	using TiXmlVisitor::Visit;
+
+	virtual bool VisitEnter( const TiXmlDocument& )	{ log += "[doc "; return true; }
+	virtual bool VisitExit( const TiXmlDocument& )	{ log += "doc] "; return true; }
+	virtual bool VisitEnter( const TiXmlElement& element, const TiXmlAttribute* )
+	{
+		log += "["; log += element.Value(); log += " ";
+		return strcmp( element.Value(), "skip" ) != 0;
+	}
+	virtual bool VisitExit( const TiXmlElement& element )
+	{
+		log += element.Value(); log += "] ";
+		return strcmp( element.Value(), "stop" ) != 0;
+	}
+	virtual bool Visit( const TiXmlText& text )
+	{
+		log += text.Value(); log += " ";
+		return strcmp( text.Value(), "stop" ) != 0;
+	}
+	virtual bool Visit( const TiXmlComment& )		{ log += "comment "; return true; }
+
+	TIXML_STRING log;
+};
+
+
+class ElementCounter : public TiXmlStaticVisitor
+{
+public:
+	using TiXmlStaticVisitor::VisitEnter;
+
+	ElementCounter() : count( 0 ) {}
+	bool VisitEnter( const TiXmlElement&, const TiXmlAttribute* )	{ ++count; return true; }
+	int count;
+};
+
+
+// Checks NextSiblingElement() and PreviousSiblingElement() of every child of
+// 'parent' against a walk through all the siblings.
+static bool ElementLinksAgree( const TiXmlNode* parent )
+{
+	for( const TiXmlNode* child = parent->FirstChild(); child; child = child->NextSibling() )
+	{
+		const TiXmlNode* node;
+		for( node = child->NextSibling(); node && !node->ToElement(); node = node->NextSibling() )
+			;
+		if ( child->NextSiblingElement() != node )
+			return false;
+		for( node = child->PreviousSibling(); node && !node->ToElement(); node = node->PreviousSibling() )
+			;
+		if ( child->PreviousSiblingElement() != node )
+			return false;
+	}
+	return true;
+}
+
+
+#ifdef TIXML_USE_STL
+static bool AttributeIsTwo( const TiXmlAttribute& attribute )
+{
+	return attribute.IntValue() == 2;
+}
+#endif
+
+
+#ifdef TIXML_USE_THREADS
+class FlagTask : public TiXmlTask
+{
+public:
+	FlagTask() : flag( false ) {}
+	virtual void Run()	{ flag = true; }
+	bool flag;
+};
+
+
+// Parses the same text many times with its own white space setting.
+class ParseTask : public TiXmlTask
+{
+public:
+	ParseTask() : whiteSpace( TIXML_WHITESPACE_DEFAULT ), matched( 0 ) {}
+	virtual void Run()
+	{
+		TiXmlParseOptions options;
+		options.whiteSpace = whiteSpace;
+		for( int i=0; i<200; ++i )
+		{
+			TiXmlDocument doc;
+			doc.SetParseOptions( options );
+			doc.Parse( "<a>  x   y  </a>" );
+			if ( strcmp( doc.RootElement()->GetText(), expected ) == 0 )
+				++matched;
+		}
+	}
+	TiXmlWhiteSpace whiteSpace;
+	const char* expected;
+	int matched;
+};
+
+
+// Reads a shared document every way it can, and checks it gets the same
+// answers as a single thread did. Run under ThreadSanitizer to check the
+// const API is free of data races (make TINYXML_SANITIZE=thread).
+class ReaderTask : public TiXmlTask
+{
+public:
+	ReaderTask() : document( 0 ), expected( 0 ), good( 0 ) {}
+	virtual void Run()
+	{
+		for( int i=0; i<50; ++i )
+		{
+			TiXmlPrinter printer;
+			document->Accept( &printer );
+			bool ok = strcmp( printer.CStr(), expected ) == 0;
+
+			ElementCounter counter;
+			document->Walk( &counter );
+			ok = ok && counter.count == 101;
+
+			int sum = 0;
+			const TiXmlElement* root = document->FirstChildElement( "root" );
+			for( const TiXmlElement* item = root->FirstChildElement( "item" ); item; item = item->NextSiblingElement( "item" ) )
+			{
+				int value = 0;
+				item->QueryIntAttribute( "value", &value );
+				sum += value;
+				ok = ok && item->GetText() && item->Attribute( "name" ) && item->Row() >= 0;
+			}
+			ok = ok && sum == 4950;
+
+			TiXmlNode* clone = document->RootElement()->Clone();
+			TiXmlPrinter clonePrinter, rootPrinter;
+			clone->Accept( &clonePrinter );
+			document->RootElement()->Accept( &rootPrinter );
+			ok = ok && strcmp( clonePrinter.CStr(), rootPrinter.CStr() ) == 0;
+			delete clone;
+
+			#ifdef TIXML_USE_STL
+			std::ostringstream stream;
+			stream << *document;
+			ok = ok && !stream.str().empty();
+			#endif
+
+			if ( ok )
+				++good;
+		}
+	}
+	const TiXmlDocument* document;
+	const char* expected;
+	int good;
+};
+
+
+// Takes snapshots of a document that is being republished, and checks each
+// is a complete, unchanging version.
+class SnapshotReader : public TiXmlTask
+{
+public:
+	SnapshotReader() : holder( 0 ), good( 0 ) {}
+	virtual void Run()
+	{
+		unsigned long last = 0;
+		for( int i=0; i<2000; ++i )
+		{
+			TiXmlSnapshot snapshot = holder->Snapshot();
+			int generation = 0;
+			snapshot->RootElement()->QueryIntAttribute( "generation", &generation );
+			if (    (unsigned long) generation == snapshot.Generation()
+				 && snapshot.Generation() >= last )
+				++good;
+			last = snapshot.Generation();
+		}
+	}
+	TiXmlDocumentHolder* holder;
+	int good;
+};
+
+
+class SnapshotWriter : public TiXmlTask
+{
+public:
+	SnapshotWriter() : holder( 0 ) {}
+	virtual void Run()
+	{
+		for( int i=2; i<=200; ++i )
+		{
+			TiXmlDocument* next = holder->CopyCurrent();
+			next->RootElement()->SetAttribute( "generation", i );
+			holder->Publish( next );
+		}
+	}
+	TiXmlDocumentHolder* holder;
+};
+
+
+// Counts what it sees, skipping the children of <skip> elements.
+class StatsVisitor : public TiXmlVisitor
+{
+public:
+	StatsVisitor() : elements( 0 ), exits( 0 ), texts( 0 ), comments( 0 ) {}
+	virtual bool VisitEnter( const TiXmlElement& element, const TiXmlAttribute* )
+	{
+		++elements;
+		return strcmp( element.Value(), "skip" ) != 0;
+	}
+	virtual bool VisitExit( const TiXmlElement& )	{ ++exits; return true; }
+	virtual bool Visit( const TiXmlText& )			{ ++texts; return true; }
+	virtual bool Visit( const TiXmlComment& )		{ ++comments; return true; }
+
+	int elements, exits, texts, comments;
+};
+
+
+class StatsFactory : public TiXmlVisitorFactory
+{
+public:
+	StatsFactory() : reduced( 0 ) {}
+	virtual TiXmlVisitor* Create()	{ return new StatsVisitor(); }
+	virtual void Reduce( TiXmlVisitor* visitor )
+	{
+		StatsVisitor* stats = static_cast< StatsVisitor* >( visitor );
+		total.elements += stats->elements;
+		total.exits += stats->exits;
+		total.texts += stats->texts;
+		total.comments += stats->comments;
+		++reduced;
+		delete stats;
+	}
+
+	StatsVisitor total;
+	int reduced;
+};
+
+
+class CountingHandler : public TiXmlAsyncHandler
+{
+public:
+	CountingHandler() : loaded( 0 ), saved( 0 ), failed( 0 ) {}
+	virtual void LoadComplete( TiXmlDocument*, bool success )			{ Count( success ? &loaded : &failed ); }
+	virtual void SaveComplete( const TiXmlDocument*, bool success )	{ Count( success ? &saved : &failed ); }
+
+	int loaded, saved, failed;
+
+private:
+	void Count( int* counter )
+	{
+		std::lock_guard< std::mutex > lock( mutex );
+		++*counter;
+	}
+	std::mutex mutex;
+};
+#endif
+
 
 int main()
 {
@@ -454,6 +779,7 @@ int main()
 		XmlTest( "Attribute round trip. double.", -1, (int)dVal );
 	}
 	
+#ifndef TIXML_SLIM_NODES
 	{
 		const char* str =	"\t<?xml version=\"1.0\" standalone=\"no\" ?>\t<room doors='2'>\n"
 							"</room>";
@@ -530,6 +856,7 @@ int main()
 		XmlTest( "Location tracking: door1 row", door1->Row(), 4 );
 		XmlTest( "Location tracking: door1 col", door1->Column(), 5 );
 	}
+#endif
 
 
 	// --------------------------------------------------------
@@ -556,8 +883,10 @@ int main()
 													0xd0U, 0xbeU, 0xd1U, 0x81U, 0xd1U, 0x82U, 0xd1U, 0x8cU, 0 };
 
 			XmlTest( "UTF-8: Russian value.", (const char*)correctValue, element->Attribute( "value" ), true );
+#ifndef TIXML_SLIM_NODES
 			XmlTest( "UTF-8: Russian value row.", 4, element->Row() );
 			XmlTest( "UTF-8: Russian value column.", 5, element->Column() );
+#endif
 
 			const unsigned char russianElementName[] = {	0xd0U, 0xa0U, 0xd1U, 0x83U,
 															0xd1U, 0x81U, 0xd1U, 0x81U,
@@ -570,12 +899,16 @@ int main()
 					 russianText,
 					 text->Value(),
 					 true );
+#ifndef TIXML_SLIM_NODES
 			XmlTest( "UTF-8: Russian element name row.", 7, text->Row() );
 			XmlTest( "UTF-8: Russian element name column.", 47, text->Column() );
+#endif
 
+#ifndef TIXML_SLIM_NODES
 			TiXmlDeclaration* dec = docH.Child( 0 ).Node()->ToDeclaration();
 			XmlTest( "UTF-8: Declaration column.", 1, dec->Column() );
 			XmlTest( "UTF-8: Document column.", 1, doc.Column() );
+#endif
 
 			// Now try for a round trip.
 			doc.SaveFile( "utf8testout.xml" );
@@ -1340,6 +1673,1029 @@ int main()
 		}*/
 	}
 
+	#ifdef TIXML_USE_STL
+	{
+		// Streaming reads the streambuf in blocks. Make sure runs longer than
+		// a block, and CDATA holding '>' characters, come through intact.
+		std::string longText( 1000, 'x' );
+		std::string xml =	"<?xml version=\"1.0\"?>"
+							"<!-- a comment with > in it -->"
+							"<root><a>" + longText + "</a>"
+							"<b><![CDATA[ x > y ]> z ]]></b>"
+							"<c attr='" + longText + "' />"
+							"</root>";
+
+		TiXmlDocument parsed;
+		parsed.Parse( xml.c_str() );
+
+		TiXmlDocument streamed;
+		istringstream in( xml );
+		in >> streamed;
+
+		std::string parsedStr, streamedStr;
+		parsedStr << parsed;
+		streamedStr << streamed;
+		XmlTest( "Block stream input matches Parse.", parsedStr.c_str(), streamedStr.c_str(), true );
+		XmlTest( "Block stream input CDATA.", " x > y ]> z ", streamed.RootElement()->FirstChildElement( "b" )->GetText() );
+		XmlTest( "Block stream input long text.", (int)longText.size(), (int)strlen( streamed.RootElement()->FirstChildElement( "a" )->GetText() ) );
+	}
+	#endif
+
+	{
+		// Loading through an input source normalizes line endings even when
+		// a CR+LF pair is split across two reads.
+		TiXmlDocument parsed;
+		parsed.Parse( "<root>\n<a>one\ntwo\nthree</a>\n</root>\n" );
+		TiXmlPrinter parsedPrinter;
+		parsed.Accept( &parsedPrinter );
+
+		TiXmlDocument trickled;
+		TrickleInputSource trickle( "<root>\r\n<a>one\r\ntwo\rthree</a>\r</root>\r\n" );
+		XmlTest( "Input source load.", true, trickled.LoadFile( &trickle ) );
+		TiXmlPrinter trickledPrinter;
+		trickled.Accept( &trickledPrinter );
+		XmlTest( "Input source line endings.", parsedPrinter.CStr(), trickledPrinter.CStr(), true );
+		XmlTest( "Input source text.", "one\ntwo\nthree", trickled.RootElement()->FirstChildElement( "a" )->GetText() );
+
+		const char* memory = "<root><a>one</a></root>";
+		TiXmlMemoryInputSource memorySource( memory, (long)strlen( memory ) );
+		TiXmlDocument fromMemory;
+		XmlTest( "Memory input source.", true, fromMemory.LoadFile( &memorySource ) );
+		XmlTest( "Memory input source text.", "one", fromMemory.RootElement()->FirstChildElement( "a" )->GetText() );
+
+		TiXmlMemoryInputSource emptySource( "", 0 );
+		TiXmlDocument empty;
+		empty.LoadFile( &emptySource );
+		XmlTest( "Empty input source.", TiXmlBase::TIXML_ERROR_DOCUMENT_EMPTY, empty.ErrorId() );
+
+		FailingInputSource failing;
+		TiXmlDocument failed;
+		failed.LoadFile( &failing );
+		XmlTest( "Failing input source.", TiXmlBase::TIXML_ERROR_OPENING_FILE, failed.ErrorId() );
+
+		TiXmlDocument loaded( "utf8test.xml" );
+		loaded.LoadFile();
+		TiXmlPrinter loadedPrinter;
+		loaded.Accept( &loadedPrinter );
+
+		TiXmlMappedInputSource mapped( "utf8test.xml" );
+		XmlTest( "Mapped input source open.", true, mapped.IsOpen() );
+		TiXmlDocument fromMapped;
+		fromMapped.LoadFile( &mapped );
+		TiXmlPrinter mappedPrinter;
+		fromMapped.Accept( &mappedPrinter );
+		XmlTest( "Mapped input source matches LoadFile.", loadedPrinter.CStr(), mappedPrinter.CStr(), true );
+
+		XmlTest( "Mapped input source parsed in place.", true, mapped.Data() != 0 );
+
+		FILE* crlf = fopen( "mappedcrlf.xml", "wb" );
+		fputs( "<a>\r\n<b>x\ry</b>\r\n</a>", crlf );
+		fclose( crlf );
+		TiXmlMappedInputSource mappedCRLF( "mappedcrlf.xml" );
+		TiXmlDocument fromCRLF;
+		fromCRLF.LoadFile( &mappedCRLF );
+		XmlTest( "Mapped input source line endings.", "x\ny", fromCRLF.RootElement()->FirstChildElement()->GetText() );
+		remove( "mappedcrlf.xml" );
+
+		TiXmlMappedInputSource missing( "no_such_file.xml" );
+		XmlTest( "Mapped input source missing file.", false, missing.IsOpen() );
+	}
+
+	#ifdef TIXML_USE_ZLIB
+	{
+		// Round trip through a gzip file, and check that LoadGzFile() still
+		// reads a plain file.
+		TiXmlDocument plain( "utf8test.xml" );
+		plain.LoadFile();
+		TiXmlPrinter plainPrinter;
+		plain.Accept( &plainPrinter );
+
+		XmlTest( "Save gzip file.", true, plain.SaveGzFile( "gztest.xml.gz" ) );
+
+		TiXmlDocument compressed;
+		XmlTest( "Load gzip file.", true, compressed.LoadGzFile( "gztest.xml.gz" ) );
+		TiXmlPrinter compressedPrinter;
+		compressed.Accept( &compressedPrinter );
+		XmlTest( "Gzip round trip.", plainPrinter.CStr(), compressedPrinter.CStr(), true );
+
+		TiXmlDocument uncompressed;
+		XmlTest( "Load uncompressed file with LoadGzFile.", true, uncompressed.LoadGzFile( "utf8test.xml" ) );
+		TiXmlPrinter uncompressedPrinter;
+		uncompressed.Accept( &uncompressedPrinter );
+		XmlTest( "Uncompressed file through LoadGzFile.", plainPrinter.CStr(), uncompressedPrinter.CStr(), true );
+
+		TiXmlDocument missing;
+		missing.LoadGzFile( "no_such_file.xml.gz" );
+		XmlTest( "Missing gzip file.", TiXmlBase::TIXML_ERROR_OPENING_FILE, missing.ErrorId() );
+	}
+	#endif
+
+	#ifdef TIXML_USE_THREADS
+	{
+		TiXmlThreadPool pool( 4 );
+		FlagTask tasks[64];
+		for( int i=0; i<64; ++i )
+			pool.Run( &tasks[i] );
+		pool.Wait();
+		int ran = 0;
+		for( int i=0; i<64; ++i )
+			ran += tasks[i].flag ? 1 : 0;
+		XmlTest( "Thread pool runs every task.", 64, ran );
+
+		// Save a few documents and load them back, all at once.
+		const int COUNT = 4;
+		const char* filenames[COUNT] = { "asynctest0.xml", "asynctest1.xml", "asynctest2.xml", "asynctest3.xml" };
+		TiXmlDocument source[COUNT];
+		TiXmlDocument loaded[COUNT];
+		for( int i=0; i<COUNT; ++i )
+		{
+			char xml[64];
+			sprintf( xml, "<doc n='%d'><a>text %d</a><b/></doc>", i, i );
+			source[i].Parse( xml );
+		}
+
+		TiXmlAsyncIO io( &pool );
+		printf( "Async I/O is %susing io_uring.\n", io.UsesIoUring() ? "" : "not " );
+		CountingHandler handler;
+		for( int i=0; i<COUNT; ++i )
+			io.SaveFile( &source[i], filenames[i], &handler );
+		io.Wait();
+		XmlTest( "Async save.", COUNT, handler.saved );
+
+		for( int i=0; i<COUNT; ++i )
+			io.LoadFile( &loaded[i], filenames[i], &handler );
+		TiXmlDocument missing;
+		io.LoadFile( &missing, "no_such_file.xml", &handler );
+		io.Wait();
+		XmlTest( "Async load.", COUNT, handler.loaded );
+		XmlTest( "Async load of a missing file fails.", 1, handler.failed );
+		XmlTest( "Async load missing file error.", TiXmlBase::TIXML_ERROR_OPENING_FILE, missing.ErrorId() );
+
+		int same = 0;
+		for( int i=0; i<COUNT; ++i )
+		{
+			TiXmlPrinter before, after;
+			source[i].Accept( &before );
+			loaded[i].Accept( &after );
+			if ( strcmp( before.CStr(), after.CStr() ) == 0 && strcmp( loaded[i].Value(), filenames[i] ) == 0 )
+				++same;
+		}
+		XmlTest( "Async round trip.", COUNT, same );
+
+		// An async save writes what SaveFile() does, mixed content, CDATA
+		// and Print() overrides included.
+		TiXmlDocument mixed;
+		mixed.Parse( "<doc>a<b>c</b>d<![CDATA[e<f]]><g/></doc>" );
+		mixed.RootElement()->LinkEndChild( new RedactedText( "hunter2" ) );
+		mixed.SaveFile( "asynctest0.xml" );
+		io.SaveFile( &mixed, "asynctest1.xml", &handler );
+		io.Wait();
+		char bytes[2][256];
+		size_t sizes[2] = { 0, 0 };
+		for( int i=0; i<2; ++i )
+		{
+			FILE* fp = fopen( filenames[i], "rb" );
+			if ( fp )
+			{
+				sizes[i] = fread( bytes[i], 1, sizeof( bytes[i] ), fp );
+				fclose( fp );
+			}
+		}
+		XmlTest( "Async save matches SaveFile.", true, sizes[0] > 0 && sizes[0] == sizes[1] && memcmp( bytes[0], bytes[1], sizes[0] ) == 0 );
+	}
+	#endif
+
+	{
+		// Reset() keeps the nodes for the next parse, which should reuse them
+		// and come out exactly as if parsed in to a fresh document.
+		const char* first  = "<?xml version='1.0'?><msg id='1'><a>one</a><![CDATA[x<y]]><!-- c --></msg>";
+		const char* second = "<?xml version='1.0' encoding='UTF-8'?><msg id='2' k='v'><a>two two</a><b/><!-- cc --><?odd?></msg>";
+
+		TiXmlDocument doc;
+		doc.Parse( first );
+		const TiXmlElement* oldRoot = doc.RootElement();
+		const TiXmlElement* oldA = oldRoot->FirstChildElement();
+		doc.Reset();
+		XmlTest( "Reset empties the document.", true, doc.FirstChild() == 0 );
+		doc.Parse( second );
+		XmlTest( "Reset reuses nodes.", true, doc.RootElement() == oldRoot || doc.RootElement() == oldA );
+
+		TiXmlDocument fresh;
+		fresh.Parse( second );
+		TiXmlPrinter reused, expected;
+		doc.Accept( &reused );
+		fresh.Accept( &expected );
+		XmlTest( "Reset then Parse matches a fresh document.", expected.CStr(), reused.CStr() );
+
+		doc.Reset();
+		doc.Parse( first );
+		const TiXmlText* cdata = doc.RootElement()->FirstChild()->NextSibling()->ToText();
+		XmlTest( "Reset CDATA.", true, cdata && cdata->CDATA() );
+		const TiXmlText* text = doc.RootElement()->FirstChild()->FirstChild()->ToText();
+		XmlTest( "Reset text is not CDATA.", false, text->CDATA() );
+
+		doc.Reset();
+		doc.Parse( "<bad a='1' a='2'/>" );
+		XmlTest( "Reset then error.", true, doc.Error() );
+		doc.Reset();
+		XmlTest( "Reset clears the error.", false, doc.Error() );
+		doc.ReleaseCache();
+		doc.Parse( first );
+		XmlTest( "Parse after ReleaseCache.", "one", doc.RootElement()->FirstChildElement( "a" )->GetText() );
+
+		// A node of a derived class isn't handed back to the parser.
+		doc.Reset();
+		doc.Parse( "<r/>" );
+		doc.RootElement()->LinkEndChild( new RedactedText( "x" ) );
+		doc.Reset();
+		doc.Parse( "<r>plain</r>" );
+		doc.SaveFile( "recycletest.xml" );
+		TiXmlDocument saved;
+		saved.LoadFile( "recycletest.xml" );
+		XmlTest( "Reset doesn't reuse derived nodes.", "plain", saved.RootElement() ? saved.RootElement()->GetText() : "" );
+		remove( "recycletest.xml" );
+
+		#ifndef TIXML_SLIM_NODES
+		// The document keeps its own user data through a Reset() and a load,
+		// but recycled nodes don't carry theirs in to the next parse.
+		int tag = 0;
+		doc.SetUserData( &tag );
+		doc.RootElement()->SetUserData( &tag );
+		doc.Reset();
+		doc.Parse( first );
+		XmlTest( "Reset keeps the document's user data.", true, doc.GetUserData() == &tag );
+		XmlTest( "Reset clears recycled nodes' user data.", true, doc.RootElement()->GetUserData() == 0 );
+		doc.SaveFile( "userdata.xml" );
+		doc.LoadFile( "userdata.xml" );
+		XmlTest( "LoadFile keeps the document's user data.", true, doc.GetUserData() == &tag );
+		remove( "userdata.xml" );
+		#endif
+	}
+
+	{
+		// Deleting a very deep tree used to recurse once per level, and run
+		// out of stack.
+		TiXmlNode* deep = new TiXmlElement( "leaf" );
+		for( int i=0; i<200000; ++i )
+		{
+			TiXmlElement* parent = new TiXmlElement( "e" );
+			parent->LinkEndChild( deep );
+			deep = parent;
+		}
+		delete deep;
+		XmlTest( "Delete a very deep tree.", true, true );
+
+		TiXmlDocument doc;
+		doc.Parse( "<a><b/><c><x/></c><d/></a>" );
+		TiXmlElement* a = doc.RootElement();
+		TiXmlNode* c = a->DetachChild( a->FirstChild( "c" ) );
+		XmlTest( "DetachChild returns the child.", "c", c ? c->Value() : "" );
+		XmlTest( "DetachChild unlinks the child.", true, c->Parent() == 0 && c->NextSibling() == 0 && c->PreviousSibling() == 0 );
+		XmlTest( "DetachChild keeps the child's children.", "x", c->FirstChild()->Value() );
+		XmlTest( "DetachChild relinks the siblings.", "d", a->FirstChild()->NextSibling()->Value() );
+		XmlTest( "DetachChild of a stranger.", true, a->DetachChild( c ) == 0 );
+		delete c;
+
+		#ifdef TIXML_USE_THREADS
+		TiXmlReclaimer reclaimer;
+		TiXmlDocument* big = new TiXmlDocument();
+		big->Parse( "<root><a/><b/></root>" );
+		reclaimer.Reclaim( big );
+		reclaimer.Reclaim( a->DetachChild( a->FirstChild( "d" ) ) );
+		reclaimer.Wait();
+		XmlTest( "Reclaim a detached child.", "b", a->LastChild()->Value() );
+		#endif
+	}
+
+	{
+		printf( "\nNode sizes: element %d, text %d, comment %d, attribute %d\n",
+				(int) sizeof( TiXmlElement ), (int) sizeof( TiXmlText ),
+				(int) sizeof( TiXmlComment ), (int) sizeof( TiXmlAttribute ) );
+
+		// The attribute list no longer has a sentinel; check both ends.
+		TiXmlElement ele( "e" );
+		ele.SetAttribute( "a", 1 );
+		ele.SetAttribute( "b", 2 );
+		ele.SetAttribute( "c", 3 );
+		ele.RemoveAttribute( "c" );
+		XmlTest( "Remove last attribute.", "b", ele.LastAttribute()->Name() );
+		ele.RemoveAttribute( "a" );
+		XmlTest( "Remove first attribute.", "b", ele.FirstAttribute()->Name() );
+		XmlTest( "Single attribute list.", true, ele.FirstAttribute()->Next() == 0 && ele.LastAttribute()->Previous() == 0 );
+		ele.RemoveAttribute( "b" );
+		XmlTest( "Empty attribute list.", true, ele.FirstAttribute() == 0 && ele.LastAttribute() == 0 );
+	}
+
+	{
+		// The type checked casts have to agree with the virtual ones.
+		TiXmlDocument doc;
+		doc.Parse( "<?xml version='1.0'?><!-- c --><a>text<!x></a>" );
+		bool agree = doc.AsDocument() == doc.ToDocument() && doc.AsElement() == 0;
+		const TiXmlNode* node = &doc;
+		int count = 0;
+		while ( node )
+		{
+			agree = agree
+				&& node->AsElement() == node->ToElement()
+				&& node->AsText() == node->ToText()
+				&& node->AsComment() == node->ToComment()
+				&& node->AsUnknown() == node->ToUnknown()
+				&& node->AsDeclaration() == node->ToDeclaration()
+				&& node->AsDocument() == node->ToDocument();
+			++count;
+			if ( node->FirstChild() )
+				node = node->FirstChild();
+			else if ( node->NextSibling() )
+				node = node->NextSibling();
+			else
+				node = node->Parent() ? node->Parent()->NextSibling() : 0;
+		}
+		XmlTest( "As casts match To casts.", true, agree );
+		XmlTest( "As casts visited every node.", 6, count );
+	}
+
+	{
+		TiXmlDocument doc;
+		doc.Parse( "<a><b>one<stop>two</stop>three</b><skip><c/></skip><!--x--><d>stop</d><e/></a>" );
+		RecordingVisitor accepted, walked;
+		doc.Accept( &accepted );
+		doc.Walk( &walked );
+		XmlTest( "Walk matches Accept.", accepted.log.c_str(), walked.log.c_str() );
+		RecordingVisitor fromChild;
+		doc.RootElement()->FirstChild()->Walk( &fromChild );
+		XmlTest( "Walk a subtree.", "[b one [stop two stop] b] ", fromChild.log.c_str() );
+
+		ElementCounter counter;
+		doc.Walk( &counter );
+		XmlTest( "Walk with a static visitor.", 7, counter.count );
+
+		TiXmlElement deep( "deep" );
+		TiXmlNode* node = &deep;
+		for( int i=0; i<100000; ++i )
+			node = node->LinkEndChild( new TiXmlElement( "e" ) );
+		ElementCounter deepCounter;
+		deep.Walk( &deepCounter );
+		XmlTest( "Walk a very deep tree.", 100001, deepCounter.count );
+	}
+
+	{
+		TiXmlDocument doc;
+		doc.Parse( "<a x='1' y='2' z='3'>text<b/><!--c--><c/><b/>more</a>" );
+		const TiXmlElement* a = doc.RootElement();
+
+		TIXML_STRING names;
+		TiXmlRange< TiXmlNodeIterator< const TiXmlNode > > children = a->Children();
+		for( TiXmlNodeIterator< const TiXmlNode > it = children.begin(); it != children.end(); ++it )
+			names += it->Value();
+		XmlTest( "Children range.", "textbccbmore", names.c_str() );
+
+		names = "";
+		TiXmlRange< TiXmlElementIterator< const TiXmlElement > > elements = a->Elements();
+		for( TiXmlElementIterator< const TiXmlElement > it = elements.begin(); it != elements.end(); it++ )
+			names += (*it).Value();
+		XmlTest( "Elements range.", "bcb", names.c_str() );
+
+		int count = 0;
+		TiXmlRange< TiXmlElementIterator< TiXmlElement > > bs = doc.RootElement()->Elements( "b" );
+		for( TiXmlElementIterator< TiXmlElement > it = bs.begin(); it != bs.end(); ++it ) {
+			it->SetAttribute( "seen", 1 );
+			++count;
+		}
+		XmlTest( "Named elements range.", 2, count );
+		XmlTest( "Named elements range is writable.", "1", a->LastChild( "b" )->ToElement()->Attribute( "seen" ) );
+		XmlTest( "Empty range.", true, a->Elements( "none" ).empty() && a->FirstChild()->Children().empty() );
+
+		names = "";
+		TiXmlRange< TiXmlAttributeIterator< const TiXmlAttribute > > attributes = a->Attributes();
+		for( TiXmlAttributeIterator< const TiXmlAttribute > it = attributes.begin(); it != attributes.end(); ++it )
+			names += it->Name();
+		XmlTest( "Attributes range.", "xyz", names.c_str() );
+
+		#ifdef TIXML_USE_STL
+		XmlTest( "Ranges with std::distance.", 6, (int) std::distance( a->Children().begin(), a->Children().end() ) );
+		XmlTest( "Ranges with std::find_if.", "y",
+				 std::find_if( attributes.begin(), attributes.end(), AttributeIsTwo )->Name() );
+		#endif
+	}
+
+	{
+		TiXmlDocument doc;
+		doc.Parse( "<r>a<x/>b<!--c--><y/>d<z/>e</r>" );
+		TiXmlElement* r = doc.RootElement();
+		XmlTest( "Element links after parsing.", true, ElementLinksAgree( r ) );
+
+		TiXmlElement w( "w" );
+		TiXmlText t( "t" );
+		r->InsertBeforeChild( r->FirstChild(), w );
+		r->InsertAfterChild( r->FirstChild( "y" ), w );
+		r->InsertAfterChild( r->LastChild(), t );
+		r->InsertBeforeChild( r->FirstChild( "z" )->NextSibling(), w );
+		XmlTest( "Element links after inserting.", true, ElementLinksAgree( r ) );
+
+		r->ReplaceChild( r->FirstChild( "y" ), t );
+		r->ReplaceChild( r->FirstChild()->NextSibling(), w );
+		XmlTest( "Element links after replacing.", true, ElementLinksAgree( r ) );
+
+		r->RemoveChild( r->FirstChild( "x" ) );
+		TiXmlNode* z = r->DetachChild( r->FirstChild( "z" ) );
+		r->LinkEndChild( z );
+		r->RemoveChild( r->FirstChild() );
+		XmlTest( "Element links after removing.", true, ElementLinksAgree( r ) );
+		XmlTest( "Previous element by name.", "z", r->LastChild()->PreviousSiblingElement( "w" )->NextSiblingElement( "z" )->Value() );
+
+		doc.Reset();
+		doc.Parse( "<r><p/>1<q/>2</r>" );
+		XmlTest( "Element links after Reset.", true, ElementLinksAgree( doc.RootElement() ) );
+	}
+
+	{
+		// Parse options belong to the document, not the process.
+		bool wasCondensed = TiXmlBase::IsWhiteSpaceCondensed();
+		TiXmlBase::SetCondenseWhiteSpace( true );
+		TiXmlParseOptions options;
+		options.whiteSpace = TIXML_WHITESPACE_PRESERVE;
+		TiXmlDocument preserve;
+		preserve.SetParseOptions( options );
+		preserve.Parse( "<a>  x   y  </a>" );
+		XmlTest( "Parse options: preserve white space.", "  x   y  ", preserve.RootElement()->GetText() );
+		XmlTest( "Parse options: global setting untouched.", true, TiXmlBase::IsWhiteSpaceCondensed() );
+
+		TiXmlBase::SetCondenseWhiteSpace( false );
+		options.whiteSpace = TIXML_WHITESPACE_CONDENSE;
+		TiXmlDocument condense;
+		condense.SetParseOptions( options );
+		condense.Parse( "<a>  x   y  </a>" );
+		TiXmlBase::SetCondenseWhiteSpace( wasCondensed );
+		XmlTest( "Parse options: condense white space.", "x y", condense.RootElement()->GetText() );
+
+		options = TiXmlParseOptions();
+		options.keepComments = false;
+		TiXmlDocument noComments;
+		noComments.SetParseOptions( options );
+		noComments.Parse( "<!--top--><a><!--in-->x<b/><!--in--></a>" );
+		TiXmlPrinter printer;
+		printer.SetStreamPrinting();
+		noComments.Accept( &printer );
+		XmlTest( "Parse options: skip comments.", "<a>x<b /></a>", printer.CStr() );
+
+		options = TiXmlParseOptions();
+		options.maxDepth = 2;
+		TiXmlDocument shallow;
+		shallow.SetParseOptions( options );
+		shallow.Parse( "<a><b>x</b></a>" );
+		XmlTest( "Parse options: within the depth limit.", false, shallow.Error() );
+		shallow.Clear();
+		shallow.Parse( "<a><b><c/></b></a>" );
+		XmlTest( "Parse options: too deep.", (int) TiXmlBase::TIXML_ERROR_NESTING_TOO_DEEP, shallow.ErrorId() );
+		XmlTest( "Parse options: too deep column.", 7, shallow.ErrorCol() );
+
+		options = TiXmlParseOptions();
+		options.tabSize = 8;
+		TiXmlDocument tabs;
+		tabs.SetParseOptions( options );
+		XmlTest( "Parse options: tab size.", 8, tabs.TabSize() );
+
+		#ifdef TIXML_USE_THREADS
+		ParseTask tasks[4];
+		for( int i=0; i<4; ++i ) {
+			tasks[i].whiteSpace = ( i & 1 ) ? TIXML_WHITESPACE_PRESERVE : TIXML_WHITESPACE_CONDENSE;
+			tasks[i].expected = ( i & 1 ) ? "  x   y  " : "x y";
+		}
+		TiXmlThreadPool pool( 4 );
+		for( int i=0; i<4; ++i )
+			pool.Run( &tasks[i] );
+		pool.Wait();
+		XmlTest( "Parse options on many threads.", 800, tasks[0].matched + tasks[1].matched + tasks[2].matched + tasks[3].matched );
+		#endif
+	}
+
+	#ifdef TIXML_USE_THREADS
+	{
+		// Many threads reading one document.
+		TIXML_STRING xml( "<?xml version='1.0'?><root>" );
+		for( int i=0; i<100; ++i )
+		{
+			char item[100];
+			sprintf( item, "<item name='n%d' value='%d'>text &amp; %d</item><!--c-->", i, i, i );
+			xml += item;
+		}
+		xml += "</root>";
+		TiXmlDocument doc;
+		doc.Parse( xml.c_str() );
+		TiXmlPrinter printer;
+		doc.Accept( &printer );
+
+		ReaderTask readers[8];
+		TiXmlThreadPool pool( 8 );
+		for( int i=0; i<8; ++i )
+		{
+			readers[i].document = &doc;
+			readers[i].expected = printer.CStr();
+			pool.Run( &readers[i] );
+		}
+		pool.Wait();
+		int good = 0;
+		for( int i=0; i<8; ++i )
+			good += readers[i].good;
+		XmlTest( "Concurrent readers agree.", 400, good );
+	}
+	#endif
+
+	#ifdef TIXML_USE_THREADS
+	{
+		TiXmlReclaimer reclaimer;
+		TiXmlDocumentHolder holder( &reclaimer );
+		XmlTest( "Holder starts empty.", true, holder.Snapshot().Document() == 0 );
+
+		TiXmlDocument* first = new TiXmlDocument();
+		first->Parse( "<config generation='1'><item/></config>" );
+		holder.Publish( first );
+		TiXmlSnapshot firstSnapshot = holder.Snapshot();
+
+		SnapshotReader readers[4];
+		SnapshotWriter writer;
+		writer.holder = &holder;
+		TiXmlThreadPool pool( 5 );
+		for( int i=0; i<4; ++i ) {
+			readers[i].holder = &holder;
+			pool.Run( &readers[i] );
+		}
+		pool.Run( &writer );
+		pool.Wait();
+
+		int good = 0;
+		for( int i=0; i<4; ++i )
+			good += readers[i].good;
+		XmlTest( "Snapshots are consistent.", 8000, good );
+		XmlTest( "Latest version published.", 200, (int) holder.Snapshot().Generation() );
+		XmlTest( "Old snapshot still valid.", "1", firstSnapshot->RootElement()->Attribute( "generation" ) );
+
+		TiXmlSnapshot copy;
+		copy = firstSnapshot;
+		firstSnapshot = holder.Snapshot();
+		XmlTest( "Snapshot copies.", 1, (int) copy.Generation() );
+	}
+	#endif
+
+	#ifdef TIXML_USE_THREADS
+	{
+		TIXML_STRING xml( "<root>" );
+		for( int i=0; i<200; ++i )
+		{
+			xml += "<group><!--c-->";
+			for( int j=0; j<20; ++j )
+				xml += "<item>text<b>bold</b></item>";
+			xml += ( i % 10 == 0 ) ? "<skip><item>hidden</item></skip>" : "<empty/>";
+			xml += "</group>";
+		}
+		xml += "</root>";
+		TiXmlDocument doc;
+		doc.Parse( xml.c_str() );
+
+		StatsVisitor serial;
+		doc.Accept( &serial );
+
+		TiXmlThreadPool pool( 4 );
+		StatsFactory factory;
+		pool.Accept( &doc, &factory );
+		XmlTest( "Parallel accept reduces every visitor.", 4, factory.reduced );
+		XmlTest( "Parallel accept elements.", serial.elements, factory.total.elements );
+		XmlTest( "Parallel accept exits.", serial.exits, factory.total.exits );
+		XmlTest( "Parallel accept texts.", serial.texts, factory.total.texts );
+		XmlTest( "Parallel accept comments.", 200, factory.total.comments );
+
+		TiXmlThreadPool single( 1 );
+		StatsFactory subtree;
+		single.Accept( doc.RootElement()->FirstChildElement(), &subtree );
+		XmlTest( "Parallel accept of a subtree.", 42, subtree.total.elements );
+	}
+	#endif
+
+	{
+		// EncodeString copies the plain runs in bulk; check the edges of them.
+		TIXML_STRING in( "plain <a href=\"x\">&'\x01\x1f&#xA9; tail&#x" );
+		TIXML_STRING out( "[" );
+		TiXmlBase::EncodeString( in, &out );
+		XmlTest( "EncodeString.", "[plain &lt;a href=&quot;x&quot;&gt;&amp;&apos;&#x01;&#x1F;&#xA9; tail&#x", out.c_str() );
+
+		out = "";
+		TiXmlBase::EncodeString( TIXML_STRING( "no escapes at all" ), &out );
+		XmlTest( "EncodeString plain.", "no escapes at all", out.c_str() );
+	}
+
+	{
+		// Print() gives the same output as Accept(), and Reset() empties
+		// the printer for another go.
+		TiXmlDocument doc;
+		doc.Parse( "<?xml version='1.0' standalone='yes'?><!--c--><root a='1' b='say \"hi\"'>"
+				   "<t>x &amp; y</t><![CDATA[<raw>]]><e/><!ELEMENT x>tail&#x01;</root>" );
+		TiXmlPrinter accepted;
+		doc.Accept( &accepted );
+
+		TiXmlPrinter printer;
+		printer.Print( doc );
+		XmlTest( "Printer print.", accepted.CStr(), printer.CStr() );
+		XmlTest( "Printer print size.", (int) accepted.Size(), (int) printer.Size() );
+
+		printer.Reset();
+		XmlTest( "Printer reset.", 0, (int) printer.Size() );
+		printer.SetStreamPrinting();
+		printer.Print( *doc.RootElement()->FirstChildElement() );
+		XmlTest( "Printer reused.", "<t>x &amp; y</t>", printer.CStr() );
+	}
+
+	{
+		// SaveFile goes through a buffer that is flushed in blocks; save a
+		// document bigger than a block and read it back.
+		TiXmlDocument doc;
+		TiXmlElement* root = new TiXmlElement( "root" );
+		doc.LinkEndChild( root );
+		for( int i=0; i<5000; ++i )
+		{
+			TiXmlElement* item = new TiXmlElement( "item" );
+			item->SetAttribute( "index", i );
+			item->LinkEndChild( new TiXmlText( "a & b < c" ) );
+			root->LinkEndChild( item );
+		}
+		doc.SaveFile( "blocktest.xml" );
+
+		TiXmlDocument loaded;
+		loaded.LoadFile( "blocktest.xml" );
+		TiXmlPrinter saved, reloaded;
+		doc.Accept( &saved );
+		loaded.Accept( &reloaded );
+		XmlTest( "Saved in blocks.", saved.CStr(), reloaded.CStr() );
+		remove( "blocktest.xml" );
+	}
+
+	{
+		// A node that overrides Print( FILE* ) is printed with it.
+		TiXmlDocument doc;
+		TiXmlElement* root = new TiXmlElement( "root" );
+		doc.LinkEndChild( root );
+		TiXmlElement* secret = new TiXmlElement( "secret" );
+		secret->LinkEndChild( new RedactedText( "hunter2" ) );
+		root->LinkEndChild( secret );
+		doc.SaveFile( "blocktest.xml" );
+
+		TiXmlDocument loaded;
+		loaded.LoadFile( "blocktest.xml" );
+		XmlTest( "Overridden Print() saved.", "***", loaded.RootElement()->FirstChildElement()->GetText() );
+		remove( "blocktest.xml" );
+	}
+
+	{
+		// A printer with a sink sends its output on in chunks.
+		TiXmlDocument doc;
+		TiXmlElement* root = new TiXmlElement( "root" );
+		doc.LinkEndChild( root );
+		for( int i=0; i<2000; ++i )
+		{
+			TiXmlElement* item = new TiXmlElement( "item" );
+			item->SetAttribute( "index", i );
+			item->LinkEndChild( new TiXmlText( "a & b" ) );
+			root->LinkEndChild( item );
+		}
+		TiXmlPrinter whole;
+		doc.Accept( &whole );
+
+		CollectingSink sink;
+		TiXmlPrinter printer;
+		printer.SetSink( &sink, 4096 );
+		doc.Accept( &printer );
+		XmlTest( "Sink gets all the output.", whole.CStr(), sink.output.c_str() );
+		XmlTest( "Sink written in chunks.", true, sink.writes > 10 && sink.largest < 4096 + 100 );
+		XmlTest( "Sink leaves the printer empty.", 0, (int) printer.Size() );
+		XmlTest( "Sink flushed.", true, printer.Flush() );
+
+		CollectingSink elementSink;
+		TiXmlPrinter elementPrinter;
+		elementPrinter.SetSink( &elementSink );
+		elementPrinter.SetStreamPrinting();
+		root->FirstChildElement()->Accept( &elementPrinter );
+		elementPrinter.Flush();
+		XmlTest( "Sink after Flush().", "<item index=\"0\">a &amp; b</item>", elementSink.output.c_str() );
+
+		FailingOutputSink failing;
+		TiXmlPrinter failingPrinter;
+		failingPrinter.SetSink( &failing );
+		doc.Accept( &failingPrinter );
+		XmlTest( "Sink failure reported.", false, failingPrinter.Flush() );
+
+		FILE* file = fopen( "sinktest.xml", "w" );
+		TiXmlFileOutputSink fileSink( file );
+		TiXmlPrinter filePrinter;
+		filePrinter.SetSink( &fileSink );
+		doc.Accept( &filePrinter );
+		fclose( file );
+		TiXmlDocument loaded;
+		loaded.LoadFile( "sinktest.xml" );
+		TiXmlPrinter reloaded;
+		loaded.Accept( &reloaded );
+		XmlTest( "File sink.", whole.CStr(), reloaded.CStr() );
+		remove( "sinktest.xml" );
+	}
+
+	{
+		// TiXmlWriter writes the same thing as printing the document would.
+		TiXmlDocument doc;
+		doc.Parse( "<?xml version='1.0' encoding='UTF-8'?><!-- report --><report title='a &amp; b' quote='say \"hi\"'>"
+				   "<row id='1' ratio='0.5'>fish &lt; chips</row><empty/><group><item/><![CDATA[<raw>]]></group></report>" );
+		TiXmlPrinter printer;
+		doc.Accept( &printer );
+
+		TiXmlWriter writer;
+		writer.PushDeclaration( "1.0", "UTF-8", "" );
+		writer.PushComment( " report " );
+		writer.OpenElement( "report" );
+		writer.PushAttribute( "title", "a & b" );
+		writer.PushAttribute( "quote", "say \"hi\"" );
+		writer.OpenElement( "row" );
+		writer.PushAttribute( "id", 1 );
+		writer.PushAttribute( "ratio", 0.5 );
+		writer.PushText( "fish < chips" );
+		writer.CloseElement();
+		writer.OpenElement( "empty" );
+		writer.CloseElement();
+		writer.OpenElement( "group" );
+		writer.OpenElement( "item" );
+		writer.CloseElement();
+		writer.PushText( "<raw>", true );
+		writer.CloseElement();
+		writer.CloseElement();
+		XmlTest( "Writer matches printer.", printer.CStr(), writer.CStr() );
+		XmlTest( "Writer depth.", 0, writer.Depth() );
+
+		writer.Reset();
+		writer.SetStreamPrinting();
+		CollectingSink sink;
+		writer.SetSink( &sink );
+		writer.OpenElement( "a" );
+		writer.OpenElement( "b" );
+		writer.PushText( "x" );
+		writer.CloseElement();
+		writer.CloseElement();
+		XmlTest( "Writer to a sink.", "<a><b>x</b></a>", sink.output.c_str() );
+		XmlTest( "Writer flushed.", true, writer.Flush() );
+
+		// Null values are written as empty, as SetAttribute() treats them.
+		TiXmlWriter nulls;
+		nulls.SetStreamPrinting();
+		nulls.OpenElement( "a" );
+		nulls.PushAttribute( "k", (const char*) 0 );
+		nulls.PushText( 0 );
+		nulls.CloseElement();
+		XmlTest( "Writer null values.", "<a k=\"\"></a>", nulls.CStr() );
+	}
+
+	#ifdef TIXML_USE_THREADS
+	{
+		// Printing in parallel gives the same output as printing in one go.
+		TiXmlDocument doc;
+		doc.LinkEndChild( new TiXmlDeclaration( "1.0", "", "" ) );
+		TiXmlElement* root = new TiXmlElement( "root" );
+		doc.LinkEndChild( root );
+		for( int i=0; i<40; ++i )
+		{
+			TiXmlElement* group = new TiXmlElement( "group" );
+			group->SetAttribute( "index", i );
+			root->LinkEndChild( group );
+			for( int j=0; j<(i % 4 == 0 ? 400 : 20); ++j )
+			{
+				TiXmlElement* item = new TiXmlElement( "item" );
+				item->LinkEndChild( new TiXmlText( "a & b" ) );
+				group->LinkEndChild( item );
+				group->LinkEndChild( new TiXmlComment( "c" ) );
+			}
+		}
+		root->LinkEndChild( new TiXmlText( "tail" ) );
+
+		TiXmlPrinter serial;
+		doc.Accept( &serial );
+
+		TiXmlThreadPool pool( 4 );
+		TiXmlPrinter parallel;
+		pool.Print( doc, &parallel );
+		XmlTest( "Parallel print.", serial.CStr(), parallel.CStr() );
+
+		TiXmlPrinter element;
+		pool.Print( *root, &element );
+		TiXmlPrinter serialElement;
+		root->Accept( &serialElement );
+		XmlTest( "Parallel print of an element.", serialElement.CStr(), element.CStr() );
+
+		CollectingSink sink;
+		TiXmlPrinter sinkPrinter;
+		sinkPrinter.SetSink( &sink, 1024 );
+		sinkPrinter.SetStreamPrinting();
+		pool.Print( doc, &sinkPrinter );
+		TiXmlPrinter streamed;
+		streamed.SetStreamPrinting();
+		doc.Accept( &streamed );
+		XmlTest( "Parallel print to a sink.", streamed.CStr(), sink.output.c_str() );
+	}
+	#endif
+
+	{
+		// Raw text and attribute values are printed as they are; values
+		// set with nothing to encode print the same as before.
+		TiXmlDocument doc;
+		TiXmlElement* root = new TiXmlElement( "root" );
+		doc.LinkEndChild( root );
+		root->SetAttribute( "id", 42 );
+		root->SetAttribute( "name", "a<b" );
+		root->SetAttribute( "escaped", "&lt;" );
+		root->LinkEndChild( new TiXmlText( "fish &amp; chips" ) );
+		TiXmlText* plain = new TiXmlText( "plain" );
+		root->LinkEndChild( plain );
+
+		TiXmlPrinter printer;
+		printer.SetStreamPrinting();
+		doc.Accept( &printer );
+		XmlTest( "Encoded text and attributes.",
+				 "<root id=\"42\" name=\"a&lt;b\" escaped=\"&amp;lt;\">fish &amp;amp; chipsplain</root>",
+				 printer.CStr() );
+
+		root->FirstChild()->ToText()->SetRaw( true );
+		root->FirstAttribute()->Next()->Next()->SetRaw( true );
+		plain->SetValue( "x > y" );
+		TiXmlElement* copy = root->Clone()->ToElement();
+		printer.Reset();
+		copy->Accept( &printer );
+		XmlTest( "Raw text and attributes.",
+				 "<root id=\"42\" name=\"a&lt;b\" escaped=\"&lt;\">fish &amp; chipsx &gt; y</root>",
+				 printer.CStr() );
+		delete copy;
+	}
+
+	{
+		// A template renders the same as the document with the values in it.
+		const char* source =	"<?xml version='1.0'?>"
+								"<order id='${id}' copy='${id}'>"
+								"<!-- ${id} -->"
+								"<item>${item}</item>"
+								"<note>${item} and ${extra}!</note>"
+								"</order>";
+		TiXmlDocument doc;
+		doc.Parse( source );
+		TiXmlTemplate order;
+		order.Compile( doc );
+		XmlTest( "Template slots.", 3, order.Slots() );
+		XmlTest( "Template slot name.", "item", order.SlotName( order.Slot( "item" ) ) );
+		XmlTest( "Template missing slot.", -1, order.Slot( "nothing" ) );
+
+		const char* values[ 3 ];
+		values[ order.Slot( "id" ) ] = "17";
+		values[ order.Slot( "item" ) ] = "fish & \"chips\"";
+		values[ order.Slot( "extra" ) ] = 0;
+		TIXML_STRING rendered;
+		order.Render( values, &rendered );
+
+		TiXmlDocument filled;
+		filled.Parse( "<?xml version='1.0'?>"
+					  "<order id='17' copy='17'>"
+					  "<!-- ${id} -->"
+					  "<item>fish &amp; &quot;chips&quot;</item>"
+					  "<note>fish &amp; &quot;chips&quot; and !</note>"
+					  "</order>" );
+		TiXmlPrinter printer;
+		filled.Accept( &printer );
+		XmlTest( "Template render.", printer.CStr(), rendered.c_str() );
+
+		values[ order.Slot( "id" ) ] = "18";
+		rendered.resize( 0 );
+		order.Render( values, &rendered );
+		XmlTest( "Template render again.", true, strstr( rendered.c_str(), "<order id=\"18\" copy=\"18\">" ) != 0 );
+	}
+
+	{
+		// Canonical XML.
+		TiXmlDocument doc;
+		doc.Parse(	"<?xml version='1.0'?>\n"
+					"<?pi-target data?>\n"
+					"<!DOCTYPE doc SYSTEM 'doc.dtd'>\n"
+					"<doc b='2' a=\"1\" xmlns:z='urn:z' z:c='3' xmlns='urn:d'>"
+					"<e1   />"
+					"<e2 x='&amp;&lt;&gt;&quot;\"'/>"
+					"<!-- comment -->"
+					"<![CDATA[a<b>]]>"
+					"<e3 xmlns:z='urn:z' xmlns:y='urn:y' xmlns=''><e4 xmlns=''/></e3>"
+					"</doc>\n"
+					"<!-- after -->" );
+
+		TiXmlCanonicalPrinter canonical;
+		doc.Accept( &canonical );
+		XmlTest( "Canonical XML.",
+				 "<?pi-target data?>\n"
+				 "<doc xmlns=\"urn:d\" xmlns:z=\"urn:z\" a=\"1\" b=\"2\" z:c=\"3\">"
+				 "<e1></e1>"
+				 "<e2 x=\"&amp;&lt;>&quot;&quot;\"></e2>"
+				 "a&lt;b&gt;"
+				 "<e3 xmlns=\"\" xmlns:y=\"urn:y\"><e4></e4></e3>"
+				 "</doc>",
+				 canonical.CStr() );
+
+		CollectingSink sink;
+		TiXmlCanonicalPrinter withComments;
+		withComments.SetComments( true );
+		withComments.SetSink( &sink, 16 );
+		doc.Accept( &withComments );
+		XmlTest( "Canonical XML with comments, to a sink.", true,
+				 strstr( sink.output.c_str(), "<!-- comment -->a&lt;b&gt;" ) != 0
+				 && strstr( sink.output.c_str(), "</doc>\n<!-- after -->" ) != 0 );
+
+		// An element on its own takes its namespaces with it.
+		canonical.Reset();
+		doc.RootElement()->FirstChildElement( "e2" )->Accept( &canonical );
+		XmlTest( "Canonical XML of an element.",
+				 "<e2 xmlns=\"urn:d\" xmlns:z=\"urn:z\" x=\"&amp;&lt;>&quot;&quot;\"></e2>",
+				 canonical.CStr() );
+	}
+
+	#ifndef TIXML_SLIM_NODES
+	{
+		// A caching printer gives the same output as a fresh one, after
+		// any kind of edit.
+		TiXmlDocument doc;
+		doc.Parse( "<root><a x='1'><b>one</b><b>two</b></a><c><d/><d/></c><e>text</e></root>" );
+		TiXmlElement* a = doc.RootElement()->FirstChildElement( "a" );
+		TiXmlElement* c = doc.RootElement()->FirstChildElement( "c" );
+
+		TiXmlPrinter cached;
+		cached.SetCaching( 1 );
+		doc.Accept( &cached );
+		TiXmlPrinter fresh;
+		doc.Accept( &fresh );
+		XmlTest( "Caching print.", fresh.CStr(), cached.CStr() );
+
+		cached.Reset();
+		doc.Accept( &cached );
+		XmlTest( "Caching print, again.", fresh.CStr(), cached.CStr() );
+
+		a->FirstChildElement()->FirstChild()->SetValue( "uno" );
+		a->FirstAttribute()->SetValue( "2" );
+		c->RemoveChild( c->FirstChild() );
+		doc.RootElement()->LinkEndChild( a->Clone() );
+		doc.RootElement()->InsertEndChild( *doc.RootElement()->FirstChildElement( "e" ) );
+		doc.RootElement()->FirstChildElement( "e" )->FirstChild()->ToText()->SetCDATA( true );
+
+		cached.Reset();
+		doc.Accept( &cached );
+		fresh.Reset();
+		doc.Accept( &fresh );
+		XmlTest( "Caching print after edits.", fresh.CStr(), cached.CStr() );
+
+		// Moved to a new depth, and printed with a new indent.
+		doc.RootElement()->RemoveChild( c );
+		TiXmlElement* f = new TiXmlElement( "f" );
+		doc.RootElement()->LinkEndChild( f );
+		f->LinkEndChild( doc.RootElement()->DetachChild( a ) );
+		cached.Reset();
+		cached.SetIndent( "\t" );
+		cached.Print( doc );
+		fresh.Reset();
+		fresh.SetIndent( "\t" );
+		doc.Accept( &fresh );
+		XmlTest( "Caching print after a move.", fresh.CStr(), cached.CStr() );
+
+		cached.Reset();
+		cached.Print( *a );
+		TiXmlPrinter freshElement;
+		freshElement.SetIndent( "\t" );
+		a->Accept( &freshElement );
+		XmlTest( "Caching print of an element.", freshElement.CStr(), cached.CStr() );
+	}
+
+	{
+		// Caching while printing to a sink, a chunk at a time.
+		TiXmlDocument doc;
+		TiXmlElement* root = new TiXmlElement( "root" );
+		doc.LinkEndChild( root );
+		for( int i=0; i<200; ++i )
+		{
+			TiXmlElement* item = new TiXmlElement( "item" );
+			item->SetAttribute( "n", i );
+			item->LinkEndChild( new TiXmlText( "some text" ) );
+			root->LinkEndChild( item );
+		}
+
+		TiXmlPrinter cached;
+		cached.SetCaching( 1 );
+		CollectingSink first;
+		cached.SetSink( &first, 256 );
+		doc.Accept( &cached );
+
+		root->FirstChildElement()->NextSiblingElement()->FirstChild()->SetValue( "changed" );
+		CollectingSink second;
+		cached.SetSink( &second, 256 );
+		doc.Accept( &cached );
+
+		TiXmlPrinter fresh;
+		doc.Accept( &fresh );
+		XmlTest( "Caching print to a sink.", fresh.CStr(), second.output.c_str() );
+	}
+	#endif
+
 	/*  1417717 experiment
 	{
 		TiXmlDocument xml;